@@ -5,16 +5,67 @@
 */
 
 #include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <functional>
 #include <string>
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <ctime>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <new>
 /* If compiled on Windows, enable colored console output */
 #ifdef _WIN32
     #define NOMINMAX
     #include <Windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #ifdef __linux__
+        #include <pthread.h>
+        #include <sched.h>
+        #include <sys/syscall.h>
+    #endif
+#endif
+namespace fs = std::filesystem;
+
+/* SSE2 is part of every x64 target, the batched playout engine falls back to "move" without it */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MANCALA_SSE2
+    #include <emmintrin.h>
+#endif
+/*
+    AVX2 gathers for the N-tuple evaluation, built for every x64 target and used if the CPU has AVX2, see "CpuHasAvx2".
+    MSVC takes the intrinsics without /arch:AVX2, GCC and Clang compile the one function that uses them for AVX2.
+*/
+#if defined(_M_X64) || defined(__x86_64__)
+    #define MANCALA_AVX2
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define MANCALA_TARGET_AVX2
+    #else
+        #define MANCALA_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
 #endif
 
 #define POSITION_LENGTH 14
+/* Boards are stored in 16 bytes, "ComputerEmpty" reads 8 bytes starting at field 7 */
+#define POSITION_SIZE 16
 #define PLAYER_SCORE 6
 #define COMPUTER_SCORE 13
 
@@ -91,363 +142,5260 @@ bool move(uint8_t* position, uint8_t selection, bool& player)
     }
 }
 
+/* Kinds of moves, from quiet to most forcing */
+#define MOVE_QUIET 0
+#define MOVE_CAPTURE 1
+#define MOVE_EXTRA 2
+
+/* Kind of the move of "field" without playing it, sowings of more than one lap count as quiet */
+inline uint8_t moveKind(const uint8_t* position, uint8_t field, bool player)
+{
+    uint8_t first = player ? 0 : 7;
+    uint8_t count = position[field];
+    /* Position in the sowing cycle of the side, 0 - 5 own fields, 6 own "Score" field, 7 - 12 enemy fields */
+    uint8_t landing = (field - first + count) % 13;
+    if (landing == 6)
+        return MOVE_EXTRA;
+    if (landing < 6 && count <= 13)
+    {
+        uint8_t target = first + landing;
+        /* Exactly one lap empties and refills the start field, sowings that wrap around also feed the opposite field */
+        if (count == 13 || (position[target] == 0 && (position[12 - target] > 0 || landing < field - first)))
+            return MOVE_CAPTURE;
+    }
+    return MOVE_QUIET;
+}
+
 /*
-    Tree-Search
-    Adapted to work with variable turn orders.
-    Recursive.
-    Returns the static evaluation of its children.
-    Optimizing for root "player" call.
+    N-tuple evaluation
+    Pattern tables over tuples of fields: the stone counts of the fields of a tuple (capped at 15) form the index
+    into that tuple's weight table. Tuples are defined relative to a side, 0 - 5 are its own fields and 6 - 11 the
+    enemy fields, both in sowing order, so the opposite of own field i is 11 - i.
+    Every tuple is looked up from the view of both sides, "Computer" tables count positive and "Player" tables negative.
+    The evaluation is the store difference plus the table sum (Computer positive, like "Evaluation").
 */
-int8_t minimax(uint8_t* position, bool player, uint8_t depth, int8_t alpha, int8_t beta)
+#define NTUPLE_COUNT 8
+#define NTUPLE_LENGTH 4
+#define NTUPLE_CAP 15
+#define NTUPLE_ENTRIES (1 << (4 * NTUPLE_LENGTH))
+#define NTUPLE_MAGIC 0x4E544E4D
+
+#ifdef MANCALA_AVX2
+/* Whether the CPU has AVX2 and the OS saves the YMM registers, checked once at startup */
+bool detectAvx2()
 {
-    /* Branch terminating events */
-    /* If terminal return evaluation */
-    if (PlayerEmpty(position))
-    { 
-        for (int i = 7; i < 13; i++)
-            position[COMPUTER_SCORE] += position[i];
-        return Evaluation(position);
+#if defined(__AVX2__)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    /* OSXSAVE and AVX */
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+const bool CpuHasAvx2 = detectAvx2();
+
+/* Sum of the 8 "Computer" entries minus the 8 "Player" entries of "indices", one gather each */
+MANCALA_TARGET_AVX2 float gatherTupleSum(const float* table, const int32_t* indices)
+{
+    __m256 computer = _mm256_i32gather_ps(table, _mm256_load_si256((const __m256i*)indices), 4);
+    __m256 player = _mm256_i32gather_ps(table, _mm256_load_si256((const __m256i*)(indices + 8)), 4);
+    __m256 difference = _mm256_sub_ps(computer, player);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(difference), _mm256_extractf128_ps(difference, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+#endif
+
+class NTupleNetwork
+{
+private:
+    /* Absolute fields of every tuple, first from the view of "Computer" then of "Player" */
+    uint8_t fields[2 * NTUPLE_COUNT][NTUPLE_LENGTH];
+
+public:
+    static constexpr uint8_t Tuples[NTUPLE_COUNT][NTUPLE_LENGTH] =
+    {
+        { 0, 1, 2, 3 }, { 2, 3, 4, 5 }, { 6, 7, 8, 9 }, { 8, 9, 10, 11 },
+        { 0, 11, 1, 10 }, { 2, 9, 3, 8 }, { 4, 7, 5, 6 }, { 3, 4, 5, 6 }
+    };
+
+    /* NTUPLE_COUNT tables of NTUPLE_ENTRIES weights, in stones */
+    std::vector<float> weights;
+
+    NTupleNetwork()
+        : weights(NTUPLE_COUNT * NTUPLE_ENTRIES, 0.0f)
+    {
+        for (int t = 0; t < NTUPLE_COUNT; t++)
+        {
+            for (int k = 0; k < NTUPLE_LENGTH; k++)
+            {
+                uint8_t relative = Tuples[t][k];
+                fields[t][k] = relative < 6 ? relative + 7 : relative - 6;
+                fields[NTUPLE_COUNT + t][k] = relative < 6 ? relative : relative + 1;
+            }
+        }
     }
-    if (ComputerEmpty(position))
+
+    /* Offsets into "weights" of all tuples, first NTUPLE_COUNT from the view of "Computer", then of "Player" */
+    void Indices(const uint8_t* position, int32_t* indices) const
     {
-        for (int i = 0; i < 6; i++)
-            position[PLAYER_SCORE] += position[i];
-        return Evaluation(position);
+        alignas(16) uint8_t capped[POSITION_SIZE];
+#ifdef MANCALA_SSE2
+        _mm_store_si128((__m128i*)capped, _mm_min_epu8(_mm_loadu_si128((const __m128i*)position), _mm_set1_epi8(NTUPLE_CAP)));
+#else
+        for (int i = 0; i < POSITION_LENGTH; i++)
+            capped[i] = std::min<uint8_t>(position[i], NTUPLE_CAP);
+#endif
+        for (int v = 0; v < 2 * NTUPLE_COUNT; v++)
+        {
+            int32_t index = 0;
+            for (int k = 0; k < NTUPLE_LENGTH; k++)
+                index |= capped[fields[v][k]] << (4 * k);
+            indices[v] = (v % NTUPLE_COUNT) * NTUPLE_ENTRIES + index;
+        }
     }
-    if (depth == 0)
+
+    /* Table sum of "position", Computer positive */
+    float Value(const uint8_t* position) const
     {
-        return Evaluation(position);
+        alignas(32) int32_t indices[2 * NTUPLE_COUNT];
+        Indices(position, indices);
+#ifdef MANCALA_AVX2
+        static_assert(NTUPLE_COUNT == 8, "one gather per side");
+        if (CpuHasAvx2)
+            return gatherTupleSum(weights.data(), indices);
+#endif
+        float sum = 0.0f;
+        for (int t = 0; t < NTUPLE_COUNT; t++)
+            sum += weights[indices[t]] - weights[indices[NTUPLE_COUNT + t]];
+        return sum;
     }
 
-    /* Extend branch */
-    /* Each possible move is a new child */
-    int8_t ScoreReference;
-    /* Maximize/Minimize evaluation depending on who is being optimized */
-    if (player)
+    /* Table sum with relaxed atomic loads, for reading while trainer threads write the tables */
+    float SharedValue(const uint8_t* position) const
     {
-        /* Reference score is worst possible for lowest possible score */
-        ScoreReference = 127;
-        for (int i = 0; i < 6; i++)
-        {
-            /* Don't create child if the target field is empty, so not a viable move */
-            if (position[i] == 0)
-                continue;
-            /* Create independent duplicate of board "position" for child */
-            uint8_t PositionCopy[POSITION_LENGTH];
-            memcpy(PositionCopy, position, POSITION_LENGTH);
-            /* Recursive call, optimizing for whoever move returned next move too */
-            ScoreReference = std::min(ScoreReference, minimax(PositionCopy, move(PositionCopy, i, player), depth - 1, alpha, beta));
-            /* Alpha-Beta breakoff condition */
-            if (ScoreReference <= alpha)
-                break;
-            /* Update Beta value */
-            beta = std::min(ScoreReference, beta);
-        }      
+        int32_t indices[2 * NTUPLE_COUNT];
+        Indices(position, indices);
+        float* table = const_cast<float*>(weights.data());
+        float sum = 0.0f;
+        for (int t = 0; t < NTUPLE_COUNT; t++)
+            sum += std::atomic_ref<float>(table[indices[t]]).load(std::memory_order_relaxed)
+                - std::atomic_ref<float>(table[indices[NTUPLE_COUNT + t]]).load(std::memory_order_relaxed);
+        return sum;
     }
-    else
+
+    /*
+        Move the table sum of "position" by "delta", spread over all looked up entries.
+        Lock free Hogwild update: concurrent updates of the same entry can overwrite each other, which is rare
+        enough with tables this large that it doesn't hurt training.
+    */
+    void Update(const uint8_t* position, float delta)
     {
-        /* Reference score is worst possible for highest possible score */
-        ScoreReference = -128;
-        for (int i = 7; i < 13; i++)
+        int32_t indices[2 * NTUPLE_COUNT];
+        Indices(position, indices);
+        float step = delta / (2 * NTUPLE_COUNT);
+        for (int v = 0; v < 2 * NTUPLE_COUNT; v++)
         {
-            if (position[i] == 0)
-                continue;
-            uint8_t PositionCopy[POSITION_LENGTH];
-            memcpy(PositionCopy, position, POSITION_LENGTH);
-            ScoreReference = std::max(ScoreReference, minimax(PositionCopy, move(PositionCopy, i, player), depth -1, alpha, beta));
-            
-            if (ScoreReference >= beta)
-                break;
-            alpha = std::max(ScoreReference, alpha);
+            std::atomic_ref<float> weight(weights[indices[v]]);
+            weight.store(weight.load(std::memory_order_relaxed) + (v < NTUPLE_COUNT ? step : -step), std::memory_order_relaxed);
         }
     }
 
-    /* Return evaluation of children */
-    return ScoreReference;
-}
+    /* Leaf evaluation for "minimax" */
+    int8_t Evaluate(const uint8_t* position) const
+    {
+        float tuples = Value(position);
+        int value = Evaluation(position) + (int)(tuples + (tuples < 0.0f ? -0.5f : 0.5f));
+        return (int8_t)std::max(-127, std::min(127, value));
+    }
 
-/* 
-    Function for individual threads to call, takes "firstMove" argument which determines which 
-    first branch the thread should search.
+    /*
+        Weights file: magic, tuple count, tuple length, the relative fields of every tuple and then the weights
+        as 32-bit floats. Only files made for the tuples compiled in here are accepted.
+    */
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        uint32_t header[3];
+        uint8_t tuples[NTUPLE_COUNT][NTUPLE_LENGTH];
+        if (!file.read((char*)header, sizeof(header)) || header[0] != NTUPLE_MAGIC
+            || header[1] != NTUPLE_COUNT || header[2] != NTUPLE_LENGTH)
+            return false;
+        if (!file.read((char*)tuples, sizeof(tuples)) || memcmp(tuples, Tuples, sizeof(tuples)) != 0)
+            return false;
+        return (bool)file.read((char*)weights.data(), weights.size() * sizeof(float));
+    }
+
+    bool Save(const std::string& path) const
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        uint32_t header[3] = { NTUPLE_MAGIC, NTUPLE_COUNT, NTUPLE_LENGTH };
+        file.write((const char*)header, sizeof(header));
+        file.write((const char*)Tuples, sizeof(Tuples));
+        file.write((const char*)weights.data(), weights.size() * sizeof(float));
+        return (bool)file;
+    }
+};
+
+/*
+    Linear heuristic evaluation
+    Weighted sum of hand picked features, each of them "Computer" minus "Player" (so Computer positive):
+        store difference, stones on each side, empty fields, best capture available,
+        moves that end in the own "Score" field, and who is to move.
+    Weights are fitted to searched scores with "texel-tune".
 */
-void minimaxThreadCall(int8_t* target,uint8_t firstMove, uint8_t* position, bool player, uint8_t depth)
-{
-    uint8_t PositionCopy[POSITION_LENGTH];
-    memcpy(PositionCopy, position, POSITION_LENGTH * sizeof(uint8_t));
-    *target = minimax(PositionCopy, move(PositionCopy, firstMove, player), depth - 1, -128, 127);
-}
+#define LINEAR_FEATURES 6
 
-/* Tree-Search root call, returns best possible move with consideration of "depth" amount next moves */
-int8_t minimaxRoot(uint8_t* position, bool player, uint8_t depth)
+struct LinearEvaluation
 {
-    std::thread* workers[6];
-    int8_t* results[6];
+    static constexpr const char* Names[LINEAR_FEATURES] = { "store", "stones", "empty", "capture", "extra", "tempo" };
+    /* Plain store difference until tuned */
+    float weights[LINEAR_FEATURES] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
 
-    for (int i = 0; i < 6; i++)
+    static void Features(const uint8_t* position, bool player, float* features)
     {
-        if (position[player ? i : i + 7] == 0)
+        int stones[2] = { 0, 0 }, empty[2] = { 0, 0 }, capture[2] = { 0, 0 }, extra[2] = { 0, 0 };
+        for (int side = 0; side < 2; side++)
         {
-            results[i] = nullptr;
-            continue;
-        }      
-        int8_t* result = new int8_t;
-        std::thread* worker = new std::thread(minimaxThreadCall,result, player ? i : i + 7, position, player, depth);
-        workers[i] = worker;
-        results[i] = result;
+            /* side 0 = Player, 1 = Computer */
+            int first = side * 7;
+            for (int i = 0; i < 6; i++)
+            {
+                uint8_t count = position[first + i];
+                stones[side] += count;
+                empty[side] += count == 0;
+                extra[side] += count == 6 - i;
+                /* Captures without a full lap around the board */
+                int target = i + count;
+                if (count > 0 && target < 6 && position[first + target] == 0 && position[12 - first - target] > 0)
+                    capture[side] = std::max(capture[side], position[12 - first - target] + 1);
+            }
+        }
+        features[0] = (float)(position[COMPUTER_SCORE] - position[PLAYER_SCORE]);
+        features[1] = (float)(stones[1] - stones[0]);
+        features[2] = (float)(empty[1] - empty[0]);
+        features[3] = (float)(capture[1] - capture[0]);
+        features[4] = (float)(extra[1] - extra[0]);
+        features[5] = player ? -1.0f : 1.0f;
     }
 
-    for (int i = 0; i < 6; i++)
-        if (results[i] != nullptr)
-            workers[i]->join();
+    int8_t Evaluate(const uint8_t* position, bool player) const
+    {
+        float features[LINEAR_FEATURES];
+        Features(position, player, features);
+        float value = 0.0f;
+        for (int i = 0; i < LINEAR_FEATURES; i++)
+            value += weights[i] * features[i];
+        return (int8_t)std::max(-127.0f, std::min(127.0f, value + (value < 0.0f ? -0.5f : 0.5f)));
+    }
 
-    int8_t score = player ? 127 : -128;
-    uint8_t bestIndex;
+    /* Text file with one "name weight" line per feature */
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path);
+        std::string name;
+        float weight;
+        int found = 0;
+        while (file >> name >> weight)
+        {
+            for (int i = 0; i < LINEAR_FEATURES; i++)
+            {
+                if (name == Names[i])
+                {
+                    weights[i] = weight;
+                    found++;
+                }
+            }
+        }
+        return found == LINEAR_FEATURES;
+    }
 
-    for (int i = 0; i < 6; i++)
+    bool Save(const std::string& path) const
     {
-        if (results[i] == nullptr)
-            continue;
-        if (player && *results[i] < score)
+        std::ofstream file(path, std::ios::trunc);
+        for (int i = 0; i < LINEAR_FEATURES; i++)
+            file << Names[i] << " " << weights[i] << std::endl;
+        return (bool)file;
+    }
+};
+
+/*
+    Transposition table
+    Positions are keyed by their fields and the side to move, not by the stores: what follows a position only depends on
+    its fields while the stores just add up. Scores are stored relative to the store difference, so one entry serves every
+    position with the same fields (exact for the store difference and the n-tuple evaluation, approximate for a linear
+    evaluation that weighs the stores differently).
+    Entries are written without locks, each one is a single 64-bit word (see "TranspositionTable").
+*/
+#define TT_EXACT 0
+#define TT_LOWER 1
+#define TT_UPPER 2
+/* Depth of entries whose subtree ended in finished games only, exact relative to the stores at any depth */
+#define TT_SOLVED 255
+
+inline uint64_t positionKey(const uint8_t* position, bool player)
+{
+    uint64_t low = *(const uint64_t*)position & 0x0000FFFFFFFFFFFF;
+    uint64_t high = *(const uint64_t*)(position + 7) & 0x0000FFFFFFFFFFFF;
+    uint64_t key = (low * 0x9E3779B97F4A7C15ull) ^ (high << 1) ^ (uint64_t)player;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
+
+/*
+    Table memory
+    Large tables miss the TLB on almost every probe with 4 KB pages. Huge pages cover 2 MB (or 1 GB) per TLB entry:
+    Linux takes them from the pool reserved in /proc/sys/vm/nr_hugepages (nr_hugepages_1G under
+    /sys/kernel/mm/hugepages for 1 GB) and otherwise asks for transparent huge pages, which the kernel grants as it can.
+    Windows needs the "Lock pages in memory" privilege for large pages. Without them the table gets normal pages.
+    On NUMA systems pages are placed on the node of the thread that touches them first (the one clearing the table)
+    unless they are interleaved over all nodes, which evens out the remote accesses of threads on every node.
+*/
+#define TT_PAGES_DEFAULT 0
+#define TT_PAGES_HUGE 1
+#define TT_PAGES_GIGANTIC 2
+/* Only reported: normal pages the kernel was asked to back with transparent huge pages */
+#define TT_PAGES_TRANSPARENT 3
+#define TT_NUMA_LOCAL 0
+#define TT_NUMA_INTERLEAVE 1
+
+/* Bit mask of the online NUMA nodes, 1 on systems without NUMA */
+uint64_t numaNodes()
+{
+    uint64_t mask = 0;
+#ifdef __linux__
+    std::error_code error;
+    for (int node = 0; node < 64; node++)
+        if (fs::exists("/sys/devices/system/node/node" + std::to_string(node), error))
+            mask |= 1ull << node;
+#endif
+    return mask != 0 ? mask : 1;
+}
+
+/*
+    Zeroed memory of at least "bytes", rounded up to the page size actually used, which "pages" receives.
+    Throws std::bad_alloc like "new" if there is not even memory with normal pages.
+*/
+void* allocateTable(size_t& bytes, uint8_t& pages, uint8_t numa)
+{
+    void* memory = nullptr;
+    uint8_t requested = pages;
+    pages = TT_PAGES_DEFAULT;
+#ifdef _WIN32
+    if (requested != TT_PAGES_DEFAULT)
+    {
+        HANDLE token;
+        TOKEN_PRIVILEGES privileges = {};
+        if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
         {
-            score = *results[i];
-            bestIndex = i;
+            privileges.PrivilegeCount = 1;
+            privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+            if (LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid))
+                AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr);
+            CloseHandle(token);
         }
-        else if (!player && *results[i] > score)
+        size_t large = GetLargePageMinimum();
+        if (large > 0 && bytes >= large)
         {
-            score = *results[i];
-            bestIndex = i + 7;
+            size_t rounded = (bytes + large - 1) / large * large;
+            memory = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (memory != nullptr)
+            {
+                bytes = rounded;
+                pages = TT_PAGES_HUGE;
+            }
         }
     }
-
-#ifdef _WIN32
-    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-    std::cout << "Evaluation: ";
-    SetConsoleTextAttribute(hConsole, (score > 0) ? 4 : 9);
-    std::cout << (player ? +(-score) : +score) << std::endl;
-    SetConsoleTextAttribute(hConsole, 7);
+    if (memory == nullptr)
+        memory = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    /* Interleaving would need one VirtualAllocExNuma per node, Windows tables stay local */
+    (void)numa;
 #else
-    std::cout << "Evaluation: " << (player ? +(-score) : +score) << std::endl;
+    const int protection = PROT_READ | PROT_WRITE, flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+    const size_t sizes[3] = { 0, (size_t)2 << 20, (size_t)1 << 30 };
+    for (uint8_t size = requested; size > TT_PAGES_DEFAULT && memory == nullptr; size--)
+    {
+        int huge = MAP_HUGETLB;
+#if defined(MAP_HUGE_1GB) && defined(MAP_HUGE_2MB)
+        huge |= size == TT_PAGES_GIGANTIC ? MAP_HUGE_1GB : MAP_HUGE_2MB;
+#else
+        if (size == TT_PAGES_GIGANTIC)
+            continue;
+#endif
+        /* A smaller table would mostly be padding */
+        if (bytes < sizes[size])
+            continue;
+        size_t rounded = (bytes + sizes[size] - 1) / sizes[size] * sizes[size];
+        void* mapped = mmap(nullptr, rounded, protection, flags | huge, -1, 0);
+        if (mapped != MAP_FAILED)
+        {
+            memory = mapped;
+            bytes = rounded;
+            pages = size;
+        }
+    }
 #endif
-    return bestIndex;
+    if (memory == nullptr)
+    {
+        void* mapped = mmap(nullptr, bytes, protection, flags, -1, 0);
+        if (mapped == MAP_FAILED)
+            throw std::bad_alloc();
+        memory = mapped;
+#ifdef MADV_HUGEPAGE
+        if (requested != TT_PAGES_DEFAULT && madvise(memory, bytes, MADV_HUGEPAGE) == 0)
+            pages = TT_PAGES_TRANSPARENT;
+#endif
+    }
+#ifdef __linux__
+    /* MPOL_INTERLEAVE, set before the first touch so every page follows it */
+    uint64_t nodes = numaNodes();
+    if (numa == TT_NUMA_INTERLEAVE && (nodes & (nodes - 1)) != 0)
+        syscall(SYS_mbind, memory, bytes, 3, &nodes, sizeof(nodes) * 8 + 1, 0);
+#else
+    (void)numa;
+#endif
+#endif
+    return memory;
 }
 
-/* Print the board "position" */
-void print(unsigned char* position)
+void freeTable(void* memory, size_t bytes)
 {
 #ifdef _WIN32
-    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-    std::cout << "   < 0--1--2--3--4--5 >" << std::endl;
-    SetConsoleTextAttribute(hConsole, 4);
-    std::cout << std::setw(3) << +position[COMPUTER_SCORE];
-    SetConsoleTextAttribute(hConsole, 7);
+    (void)bytes;
+    VirtualFree(memory, 0, MEM_RELEASE);
 #else
-    std::cout << "   < 0--1--2--3--4--5 >" << std::endl;
-    std::cout << std::setw(3) << +position[COMPUTER_SCORE];
+    munmap(memory, bytes);
 #endif
-    for (int i = COMPUTER_SCORE - 1; i > PLAYER_SCORE; i--)
-        std::cout << std::setw(3) << + position[i];
+}
+
+/* Pins the calling thread to the "index"-th core it may run on, modulo their count */
+void pinThread(unsigned index)
+{
 #ifdef _WIN32
-    SetConsoleTextAttribute(hConsole, 9);
-    std::cout << std::setw(3) << +position[PLAYER_SCORE] << std::endl << "   ";
-    SetConsoleTextAttribute(hConsole, 7);
+    DWORD_PTR process, system;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system) || process == 0)
+        return;
+    unsigned cores = 0;
+    for (DWORD_PTR bits = process; bits != 0; bits &= bits - 1)
+        cores++;
+    index %= cores;
+    for (int core = 0; core < (int)sizeof(DWORD_PTR) * 8; core++)
+        if ((process >> core & 1) != 0 && index-- == 0)
+        {
+            SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << core);
+            return;
+        }
+#elif defined(__linux__)
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0)
+        return;
+    index %= CPU_COUNT(&allowed);
+    for (int core = 0; core < CPU_SETSIZE; core++)
+        if (CPU_ISSET(core, &allowed) && index-- == 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(core, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            return;
+        }
 #else
-    std::cout << std::setw(3) << +position[PLAYER_SCORE] << std::endl << "   ";
+    (void)index;
 #endif
-    for (int i = 0; i < PLAYER_SCORE; i++)
-        std::cout << std::setw(3) << +position[i];
-    std::cout << std::endl;
 }
 
-/* 
-Agent class
-Stores agent settings and contains move function for each type
-Types:
-    Random Agent = "random"
-    Human Player Agent = "player"
-    Minimax Agent = "computer"
+/*
+    Buckets of TT_BUCKET entries fill one 64 byte cache line, a probe costs a single miss. An entry is one 64-bit word,
+    written and read whole, so threads never see half of one:
+        bits  0-15  key check, the top 16 bits of the key (the low bits pick the bucket)
+        bits 16-23  depth, 0 = empty slot
+        bits 24-31  bound (2 bits) and the age of the search that stored it (6 bits)
+        bits 32-47  score
+        bits 48-55  move
+    Replacement, an entry of the same position is always updated unless it is deeper and of the current age:
+        TT_REPLACE_ALWAYS   one slot per position picked by the key, 8-byte entries without buckets
+        TT_REPLACE_DEPTH    the shallowest entry of the bucket
+        TT_REPLACE_AGED     the shallowest entry counting every age an entry is behind as TT_AGE_DEPTH plies
+        TT_REPLACE_TIERED   like aged within all slots but the last one, an entry that would have to replace a deeper
+                            one of the current search goes to the last slot, which always takes it
 */
-class Agent
+#define TT_BUCKET 8
+#define TT_AGE_DEPTH 8
+#define TT_REPLACE_ALWAYS 0
+#define TT_REPLACE_DEPTH 1
+#define TT_REPLACE_AGED 2
+#define TT_REPLACE_TIERED 3
+
+class TranspositionTable
 {
 private:
-    std::string type;
-    uint8_t depth;
+    std::atomic<uint64_t>* slots;
+    /* Bucket count - 1 */
+    uint64_t mask;
+    size_t bytes;
+    /* Page size asked for and the one the memory got */
+    uint8_t requested;
+    uint8_t pages;
+    uint8_t numa;
+    uint8_t policy = TT_REPLACE_TIERED;
+    uint8_t age = 0;
+
+    /* Largest power of two amount of buckets that fits into "megabytes" */
+    static size_t Buckets(size_t megabytes)
+    {
+        size_t count = 1;
+        while (count * 2 * TT_BUCKET * sizeof(uint64_t) <= std::max<size_t>(megabytes, 1) << 20)
+            count *= 2;
+        return count;
+    }
+
+    void Allocate(size_t megabytes)
+    {
+        size_t count = Buckets(megabytes);
+        bytes = count * TT_BUCKET * sizeof(uint64_t);
+        pages = requested;
+        slots = (std::atomic<uint64_t>*)allocateTable(bytes, pages, numa);
+        for (size_t i = 0; i < count * TT_BUCKET; i++)
+            new (&slots[i]) std::atomic<uint64_t>(0);
+        mask = count - 1;
+    }
+
+    static uint8_t Depth(uint64_t entry) { return (uint8_t)(entry >> 16); }
+    static uint8_t Age(uint64_t entry) { return (uint8_t)(entry >> 26) & 63; }
+
+    /* Replacement cost of "entry", the lowest one is replaced */
+    int Worth(uint64_t entry) const
+    {
+        return Depth(entry) - (policy == TT_REPLACE_DEPTH ? 0 : ((age - Age(entry)) & 63) * TT_AGE_DEPTH);
+    }
+
 public:
-    Agent(std::string type)
-        : type(type), depth(12)
-    {}
+    struct Hit
+    {
+        int16_t score;
+        uint8_t depth;
+        uint8_t bound;
+        uint8_t move;
+    };
 
-    Agent(std::string type, uint8_t depth)
-        : type(type), depth(depth)
-    {}
+    /*
+        Largest power of two amount of buckets that fits into "megabytes", see "Table memory" for "pages" and "numa".
+        All memory is taken here or in "Resize", searches only read and write entries.
+    */
+    explicit TranspositionTable(size_t megabytes, uint8_t pages = TT_PAGES_HUGE, uint8_t numa = TT_NUMA_LOCAL)
+        : requested(pages), numa(numa)
+    {
+        Allocate(megabytes);
+    }
 
-    void Move(uint8_t* board, bool& turn)
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    ~TranspositionTable()
     {
-        /* Minimax */
-        if (type == "computer")
+        freeTable(slots, bytes);
+    }
+
+    /* Page size the memory got, which may be smaller than the one asked for */
+    uint8_t Pages() const { return pages; }
+
+    size_t Megabytes() const { return bytes >> 20; }
+
+    /* New size with the same pages and NUMA placement, empties the table. Only while no search is using it */
+    void Resize(size_t megabytes)
+    {
+        if (Buckets(megabytes) == mask + 1)
         {
-            uint8_t cacheResult = minimaxRoot(board, turn, depth);
-            std::cout << "Calculated move: " << (turn ? cacheResult : 12 - cacheResult) << std::endl;
-            turn = move(board, cacheResult, turn);
+            Clear();
+            return;
         }
-        /* Human player */
-        else if (type == "player")
-        {
-            std::string input;
-            uint8_t inputMove;
-            std::cout << "Move:";
-            std::cin >> input;
-            inputMove = stoi(input);
-            if (0 <= inputMove && inputMove < 6 && board[turn ? inputMove : 12 - inputMove] > 0)
-                turn = move(board, turn ? inputMove : 12 - inputMove, turn);
-            else
-                std::cout << "Invalid Input!" << std::endl;
+        freeTable(slots, bytes);
+        Allocate(megabytes);
+        age = 0;
+    }
+
+    /*
+        Share of the slots that hold an entry, of any search or only of the current one ("Age"), counted over
+        the first 1024 buckets
+    */
+    double Occupancy(bool current = false) const
+    {
+        uint64_t buckets = std::min<uint64_t>(mask + 1, 1024), used = 0;
+        for (uint64_t i = 0; i < buckets * TT_BUCKET; i++)
+        {
+            uint64_t entry = slots[i].load(std::memory_order_relaxed);
+            used += Depth(entry) != 0 && (!current || Age(entry) == age);
         }
-        /* Random */
-        else
+        return (double)used / (buckets * TT_BUCKET);
+    }
+
+    void SetPolicy(uint8_t replacement) { policy = replacement; }
+
+    /* Starts a new search, the entries of the older ones become the first to be replaced */
+    void Age() { age = (age + 1) & 63; }
+
+    /* Loads the bucket of "key" into the cache ahead of its probe */
+    void Prefetch(uint64_t key) const
+    {
+#if defined(MANCALA_SSE2)
+        _mm_prefetch((const char*)&slots[(key & mask) * TT_BUCKET], _MM_HINT_T0);
+#elif defined(__GNUC__)
+        __builtin_prefetch(&slots[(key & mask) * TT_BUCKET]);
+#endif
+    }
+
+    bool Probe(uint64_t key, Hit& hit) const
+    {
+        const std::atomic<uint64_t>* bucket = &slots[(key & mask) * TT_BUCKET];
+        uint16_t check = (uint16_t)(key >> 48);
+        for (int i = 0; i < TT_BUCKET; i++)
         {
-            std::srand((unsigned int)std::time(nullptr));
-            while (true)
+            uint64_t entry = bucket[i].load(std::memory_order_relaxed);
+            if ((uint16_t)entry != check || Depth(entry) == 0)
+                continue;
+            hit.depth = Depth(entry);
+            hit.bound = (uint8_t)(entry >> 24) & 3;
+            hit.score = (int16_t)(entry >> 32);
+            hit.move = (uint8_t)(entry >> 48);
+            return true;
+        }
+        return false;
+    }
+
+    void Store(uint64_t key, int16_t score, uint8_t depth, uint8_t bound, uint8_t move)
+    {
+        std::atomic<uint64_t>* bucket = &slots[(key & mask) * TT_BUCKET];
+        uint16_t check = (uint16_t)(key >> 48);
+        uint64_t entry = check | (uint64_t)depth << 16 | (uint64_t)(bound | age << 2) << 24 | (uint64_t)(uint16_t)score << 32
+            | (uint64_t)move << 48;
+        if (policy == TT_REPLACE_ALWAYS)
+        {
+            bucket[(key >> 40) & (TT_BUCKET - 1)].store(entry, std::memory_order_relaxed);
+            return;
+        }
+
+        int victim = 0, lowest = INT32_MAX;
+        int candidates = policy == TT_REPLACE_TIERED ? TT_BUCKET - 1 : TT_BUCKET;
+        for (int i = 0; i < TT_BUCKET; i++)
+        {
+            uint64_t old = bucket[i].load(std::memory_order_relaxed);
+            if ((uint16_t)old == check && Depth(old) != 0)
             {
-                uint8_t selection = std::rand() % 6;
-                if (board[turn ? selection : 12 - selection] > 0)
-                {
-                    std::cout << "Random move: " << +selection << std::endl;
-                    turn = move(board, turn ? selection : 12 - selection, turn);
-                    break;
-                }
+                if (depth >= Depth(old) || bound == TT_EXACT || Age(old) != age)
+                    bucket[i].store(entry, std::memory_order_relaxed);
+                return;
+            }
+            int worth = Depth(old) == 0 ? INT32_MIN : Worth(old);
+            if (i < candidates && worth < lowest)
+            {
+                lowest = worth;
+                victim = i;
             }
         }
+        if (policy == TT_REPLACE_TIERED && lowest > depth)
+            victim = TT_BUCKET - 1;
+        bucket[victim].store(entry, std::memory_order_relaxed);
+    }
+
+    void Clear()
+    {
+        for (uint64_t i = 0; i < (mask + 1) * TT_BUCKET; i++)
+            slots[i].store(0, std::memory_order_relaxed);
     }
 };
 
 /*
-    Game loop container
-    Supports random position, custom start position, start selection
-    and all combinations of different agents playing against each other
+    Private stores of one root move in deterministic searches, with the full key of every entry so "MergeInto" can
+    store them in the shared table, always replaces
 */
-class Environment
+class DeltaTable
 {
 private:
-    bool turn;
-    Agent agent1;
-    Agent agent2;
-    uint8_t* position = new uint8_t[POSITION_LENGTH]
+    struct Entry
     {
-        4,4,4,4,4,4,
-        0,
-        4,4,4,4,4,4,
-        0
+        uint64_t key;
+        uint64_t data;
     };
+    std::unique_ptr<Entry[]> entries;
+    uint64_t mask;
+    /* Entries of older generations are empty, so "Clear" doesn't have to touch them */
+    uint16_t generation = 0;
 
 public:
-    Environment(Agent player1, Agent player2, bool playerStart, uint8_t board[])
-        : position(board), turn(playerStart), agent1(player1), agent2(player2)
-    {}
-    
-    Environment(Agent player1, Agent player2, bool playerStart)
-        : turn(playerStart), agent1(player1), agent2(player2)
-    {}
+    /* Largest power of two amount of entries that fits into "megabytes" */
+    explicit DeltaTable(size_t megabytes)
+    {
+        size_t count = 1;
+        while (count * 2 * sizeof(Entry) <= std::max<size_t>(megabytes, 1) << 20)
+            count *= 2;
+        entries = std::make_unique<Entry[]>(count);
+        mask = count - 1;
+    }
 
-    Environment(Agent player1, Agent player2)
-        : turn(true), agent1(player1), agent2(player2)
-    {}
+    bool Probe(uint64_t key, TranspositionTable::Hit& hit) const
+    {
+        const Entry& entry = entries[key & mask];
+        /* Depth 0 = empty */
+        if (entry.key != key || (uint8_t)(entry.data >> 16) == 0 || (uint16_t)(entry.data >> 48) != generation)
+            return false;
+        hit.score = (int16_t)(entry.data & 0xFFFF);
+        hit.depth = (uint8_t)(entry.data >> 16);
+        hit.bound = (uint8_t)(entry.data >> 24);
+        hit.move = (uint8_t)(entry.data >> 32);
+        return true;
+    }
 
-    ~Environment()
+    void Store(uint64_t key, int16_t score, uint8_t depth, uint8_t bound, uint8_t move)
     {
-        delete[] position;
+        Entry& entry = entries[key & mask];
+        entry.key = key;
+        entry.data = (uint16_t)score | (uint64_t)depth << 16 | (uint64_t)bound << 24 | (uint64_t)move << 32 | (uint64_t)generation << 48;
     }
 
-private:
-    /* Randomize position with "StoneCount" amount of stones per side */
-    void p_RandomizePosition(uint8_t StoneCount)
+    /* Empties the table for the next search, only wipes the memory once the generations wrap around */
+    void Clear()
     {
-        std::srand((unsigned int)std::time(nullptr));
+        if (++generation == 0)
+            memset(entries.get(), 0, (mask + 1) * sizeof(Entry));
+    }
 
-        for (int i = 0; i < POSITION_LENGTH; i++)
-            position[i] = 0;
+    /* Stores every entry in "table" in index order, only while no search is using "table" */
+    void MergeInto(TranspositionTable& table) const
+    {
+        TranspositionTable::Hit hit;
+        for (uint64_t i = 0; i <= mask; i++)
+            if (Probe(entries[i].key, hit))
+                table.Store(entries[i].key, hit.score, hit.depth, hit.bound, hit.move);
+    }
+};
 
-        for (int i = 0; i < StoneCount; i++)
-            position[std::rand() % 6] += 1;
+/* The delta tables of the six root moves, kept from one deterministic search to the next so a deepening only clears them */
+struct DeltaTables
+{
+    std::unique_ptr<DeltaTable> moves[6];
+};
 
-        for (int i = 0; i < 6; i++)
-            position[PLAYER_SCORE + i + 1] = position[i];
-    }
+/*
+    ProbCut model
+    A search "reduction" plies shallower predicts the deep score as "a" * shallow + "b" with a standard error of "sigma".
+    A node is cut once the shallow search shows the deep score is beyond the window by "threshold" standard errors.
+    Fitted with "probcut-calibrate", stored as a text file with one "name value" line per parameter.
+*/
+struct ProbCutModel
+{
+    float a = 1.0f;
+    float b = 0.0f;
+    float sigma = 2.0f;
+    float threshold = 1.5f;
+    uint8_t reduction = 4;
+    /* Shallowest node that is tried */
+    uint8_t minDepth = 6;
 
-public:
-    void RandomizePosition()
-    { 
-        p_RandomizePosition(4 * 6);
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path);
+        std::string name;
+        float value;
+        int found = 0;
+        while (file >> name >> value)
+        {
+            found++;
+            if (name == "a") a = value;
+            else if (name == "b") b = value;
+            else if (name == "sigma") sigma = value;
+            else if (name == "threshold") threshold = value;
+            else if (name == "reduction") reduction = (uint8_t)value;
+            else if (name == "min-depth") minDepth = (uint8_t)value;
+            else found--;
+        }
+        return found == 6 && a > 0.0f;
     }
-    void RandomizePosition(uint8_t stoneCount)
+
+    bool Save(const std::string& path) const
     {
-        p_RandomizePosition(stoneCount);
+        std::ofstream file(path, std::ios::trunc);
+        file << "a " << a << std::endl << "b " << b << std::endl << "sigma " << sigma << std::endl << "threshold " << threshold
+            << std::endl << "reduction " << +reduction << std::endl << "min-depth " << +minDepth << std::endl;
+        return (bool)file;
     }
+};
+
+/*
+    Depth semantics
+        DEPTH_PLIES         every sowing costs one ply, extra-turn chains eat into the horizon
+        DEPTH_TURNS         only moves that hand the turn over cost a ply, a whole extra-turn chain counts as one turn
+        DEPTH_FRACTIONAL    depth in quarter plies, extra turns and captures cost "extraCost" and "captureCost" quarters
+                            and quiet moves a full ply, so forcing lines are searched deeper
+*/
+#define DEPTH_PLIES 0
+#define DEPTH_TURNS 1
+#define DEPTH_FRACTIONAL 2
+#define DEPTH_QUARTERS 4
+
+/* Settings shared by every thread of one search */
+struct SearchSettings
+{
+    /* Leaf evaluation, the first one set is used, store difference if both are nullptr */
+    const NTupleNetwork* network = nullptr;
+    const LinearEvaluation* linear = nullptr;
+    /* Set by the time manager when the search has to end, the results of a stopped search are meaningless */
+    const std::atomic<bool>* stop = nullptr;
+    /* Shared by all threads, searches without one if nullptr */
+    TranspositionTable* table = nullptr;
+    /* Request the table bucket of each child before searching it */
+    bool prefetch = true;
+    /*
+        Identical scores, moves and node counts on every run: "table" is only read during a root search, each root move
+        writes into its own delta table and the deltas are merged in root move order once all threads are done.
+        Multi-PV bounds are not shared between the threads either. Searches stopped by the clock stay timing dependent.
+    */
+    bool deterministic = false;
+    /* Reused delta tables of deterministic searches, not shared by searches running at the same time, allocated per search if nullptr */
+    DeltaTables* deltas = nullptr;
+    /*
+        Threads of a root search. Root moves wait for a free thread, the ones that took the most nodes in the previous
+        iteration, or in a shallower search without one, first. Threads left over when there are fewer root moves help to
+        search the replies of the biggest ones.
+    */
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    /* Off = root moves in field order and no helpers */
+    bool balance = true;
+    /* A root move proven to win ends the search of the others, see "SearchResult::decided" */
+    bool earlyStop = true;
+    /* Every search thread on a core of its own, so it keeps its caches and stays on its NUMA node */
+    bool pinThreads = false;
+    /* Root moves that get an exact score, the others only have to be proven worse, 0 = all of them */
+    uint8_t multiPv = 0;
+    /*
+        Late move reductions: quiet moves after the first "lmrMoves" of a node are searched "lmrReduction" plies
+        shallower once "depth" reaches "lmrDepth", and again at full depth if they improve the window. 0 moves = off
+    */
+    uint8_t lmrMoves = 0;
+    uint8_t lmrDepth = 3;
+    uint8_t lmrReduction = 1;
+    /* See "Depth semantics", table entries of different semantics don't mix */
+    uint8_t depthMode = DEPTH_PLIES;
+    uint8_t extraCost = 2;
+    uint8_t captureCost = 3;
+    /* Plies of captures and extra turns searched below the horizon, 0 = static evaluation at the horizon */
+    uint8_t quiescence = 0;
+    /* Killer and counter moves order the quiet moves */
+    bool killers = true;
+    /* Enhanced transposition cutoffs, looks all children up in the table before searching the first one at "etcDepth" or more */
+    bool etc = false;
+    uint8_t etcDepth = 4;
+    /*
+        Forward pruning, both only away from the principal variation and the root
+        Multi-cut: the first "multiCutMoves" moves are searched "multiCutReduction" plies shallower at "multiCutDepth"
+        or more, if "multiCutCuts" of them fail high the node is cut. 0 moves = off
+        ProbCut: see "ProbCutModel", off if nullptr
+    */
+    uint8_t multiCutMoves = 0;
+    uint8_t multiCutCuts = 2;
+    uint8_t multiCutReduction = 2;
+    uint8_t multiCutDepth = 6;
+    const ProbCutModel* probCut = nullptr;
+
+    /* Internal depth of one ply or turn */
+    uint8_t DepthUnit() const { return depthMode == DEPTH_FRACTIONAL ? DEPTH_QUARTERS : 1; }
 
-    /* Start game loop */
-    void start()
+    /* Internal depth of a child after a move of "kind" */
+    uint8_t ChildDepth(uint8_t depth, uint8_t kind) const
     {
-        /*
-        Check for too many stones, warning at > 127, not 255 since the evaluation is int8_t 
-        so if not using minimax everything until 255 should work
-        */
-        int count = 0;
-        for (int i = 0; i < POSITION_LENGTH; i++)
-            count += position[i];
-        if (count > 127)
-            std::cout << "[WARNING]: Too many stones on field! -> Risk of variable overflow!" << std::endl;
+        uint8_t cost = depthMode == DEPTH_PLIES ? 1
+            : depthMode == DEPTH_TURNS ? (kind == MOVE_EXTRA ? 0 : 1)
+            : (kind == MOVE_EXTRA ? extraCost : kind == MOVE_CAPTURE ? captureCost : DEPTH_QUARTERS);
+        return depth > cost ? depth - cost : 0;
+    }
+};
 
-        print(position);
-        while (!PlayerEmpty(position) && !ComputerEmpty(position))
+/* Evaluation of positions where the search stops before the game ends */
+inline int8_t leafEvaluation(const uint8_t* position, bool player, const SearchSettings& settings)
+{
+    if (settings.network != nullptr)
+        return settings.network->Evaluate(position);
+    if (settings.linear != nullptr)
+        return settings.linear->Evaluate(position, player);
+    return Evaluation(position);
+}
+
+/* Longest line the principal variation table holds, deeper plies are searched but not recorded */
+#define MAX_PLY 128
+
+/* Sequence of moves as field indices, the side of a move follows from its field */
+struct PvLine
+{
+    uint8_t length = 0;
+    uint8_t moves[MAX_PLY];
+};
+
+/*
+    Multi-PV bounds of one root search
+    Once "multiPv" root moves have an exact score, a move only matters if it beats the worst of them. The root children
+    tighten their window to that score before every move they search, so the remaining root moves fail fast.
+    Ties stay inside the window, which keeps the choice between equal moves independent of thread timing.
+*/
+struct RootBounds
+{
+    std::mutex mutex;
+    std::atomic<int> alpha{ -128 };
+    std::atomic<int> beta{ 127 };
+    int8_t exact[6];
+    uint8_t count = 0;
+    uint8_t multiPv;
+    /* Side to move at the root */
+    bool player;
+
+    RootBounds(uint8_t multiPv, bool player)
+        : multiPv(multiPv), player(player)
+    {}
+
+    /* Whether a finished root move is exact, only those move the bounds */
+    bool Report(int8_t score)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (player ? score >= beta.load() : score <= alpha.load())
+            return false;
+        exact[count++] = score;
+        if (count >= multiPv)
         {
-            std::cout << " <----<---<-<>->--->---->" << std::endl;
-            if (turn)
-            {
-                std::cout << "AGENT 1" << std::endl;
-                agent1.Move(position, turn);
-            } 
+            /* Best first from the view of the side to move, the bound follows the "multiPv"-th */
+            std::sort(exact, exact + count, [this](int8_t a, int8_t b) { return player ? a < b : a > b; });
+            if (player)
+                beta.store(std::min<int>(beta.load(), exact[multiPv - 1] + 1));
             else
-            {
-                std::cout << "AGENT 2" << std::endl;
-                agent2.Move(position, turn);
-            }
-                
-            print(position);
+                alpha.store(std::max<int>(alpha.load(), exact[multiPv - 1] - 1));
         }
+        return true;
+    }
+};
 
-        std::cout << " <----<---<-<>->--->---->" << std::endl;
+/* Work counters of one search thread */
+struct SearchStats
+{
+    uint64_t nodes = 0;
+    /* Enhanced transposition cutoffs: children looked up before searching any of them, and nodes cut that way */
+    uint64_t etcProbes = 0;
+    uint64_t etcCutoffs = 0;
+    /* Transposition table lookups of the searched nodes and the ones that found their position */
+    uint64_t tableProbes = 0;
+    uint64_t tableHits = 0;
 
-        if (PlayerEmpty(position))
-        {
-            for (int i = 7; i < 13; i++)
-            {
-                position[COMPUTER_SCORE] += position[i];
-                position[i] = 0;
-            }
-        }
+    SearchStats& operator+=(const SearchStats& other)
+    {
+        nodes += other.nodes;
+        tableProbes += other.tableProbes;
+        tableHits += other.tableHits;
+        etcProbes += other.etcProbes;
+        etcCutoffs += other.etcCutoffs;
+        return *this;
+    }
+};
 
-        if (ComputerEmpty(position))
+/*
+    Search state owned by one thread
+    Row "ply" of the triangular PV table holds the best line found below the node at that ply, a node puts its move
+    in front of the row of its best child. "previous" is the line of the last search from the same root, its moves
+    are searched first for as long as the current path follows it.
+*/
+struct SearchContext
+{
+    uint8_t pvLength[MAX_PLY];
+    uint8_t pv[MAX_PLY][MAX_PLY];
+    const PvLine* previous = nullptr;
+    bool followPv = false;
+    SearchStats stats;
+    /* Window the root move has to reach to be among the "multiPv" best, checked by the child of the root */
+    RootBounds* bounds = nullptr;
+    /* Deterministic searches write here and read it before the shared table */
+    DeltaTable* delta = nullptr;
+    /*
+        Proofs: a store above half of the "stones" decides the game (0 = not checked). "sure" is left by every node for
+        its caller: the sign of the returned score is the sign of the game result. "horizon" counts the leaves that are
+        not finished games, a node searched without adding any has an exact score.
+    */
+    uint8_t stones = 0;
+    bool sure = false;
+    uint64_t horizon = 0;
+    /* Set by the root once another root move is proven to win, "aborted" is set when a node saw it or "settings.stop" */
+    const std::atomic<bool>* decided = nullptr;
+    bool aborted = false;
+    /*
+        Quiet moves that caused the last cutoffs at each ply, and the quiet move that refuted each field the last time
+        it was played ("path" holds the move played at each ply of the current line). 0xFF = none
+    */
+    uint8_t killers[MAX_PLY][2];
+    uint8_t counters[16];
+    uint8_t path[MAX_PLY];
+
+    SearchContext()
+    {
+        memset(killers, 0xFF, sizeof(killers));
+        memset(counters, 0xFF, sizeof(counters));
+    }
+
+    /* Quiet move "field" caused a cutoff at "ply" */
+    void Cutoff(uint8_t ply, uint8_t field)
+    {
+        if (ply >= MAX_PLY)
+            return;
+        if (killers[ply][0] != field)
         {
-            for (int i = 0; i < 6; i++)
-            {
-                position[PLAYER_SCORE] += position[i];
-                position[i] = 0;
-            }
+            killers[ply][1] = killers[ply][0];
+            killers[ply][0] = field;
         }
+        if (ply > 0)
+            counters[path[ply - 1]] = field;
+    }
+};
 
-        print(position);
+/*
+    Principal variation of "position" as text, fields numbered like the CLI, a "+" marks a move that earns an extra turn.
+    The line is replayed, so the last move is marked too.
+*/
+std::string formatPv(const PvLine& line, const uint8_t* position)
+{
+    uint8_t board[POSITION_SIZE];
+    memcpy(board, position, POSITION_SIZE);
+    std::string text;
+    for (int i = 0; i < line.length; i++)
+    {
+        bool player = line.moves[i] < 7;
+        if (i > 0)
+            text += " ";
+        text += player ? "P" : "C";
+        text += std::to_string(player ? line.moves[i] : 12 - line.moves[i]);
+        if (move(board, line.moves[i], player) == player)
+            text += "+";
+    }
+    return text;
+}
 
-        if (position[PLAYER_SCORE] > position[COMPUTER_SCORE])
-            std::cout << "AGENT 1 WON" << std::endl;
-        else if (position[PLAYER_SCORE] < position[COMPUTER_SCORE])
-            std::cout << "AGENT 2 WON" << std::endl;
+/*
+    Quiescence search
+    A static evaluation in the middle of a capture or an extra-turn chain misjudges the position. Below the horizon only
+    extra turns and captures are searched, for at most "depth" plies, and the side to move may always stand pat on the
+    static evaluation instead, as it still has its quiet moves.
+*/
+int8_t quiescence(uint8_t* position, bool player, uint8_t depth, int8_t alpha, int8_t beta, const SearchSettings& settings,
+    SearchContext& context)
+{
+    context.stats.nodes++;
+    if (PlayerEmpty(position))
+    {
+        for (int i = 7; i < 13; i++)
+            position[COMPUTER_SCORE] += position[i];
+        return Evaluation(position);
+    }
+    if (ComputerEmpty(position))
+    {
+        for (int i = 0; i < 6; i++)
+            position[PLAYER_SCORE] += position[i];
+        return Evaluation(position);
+    }
+    int8_t ScoreReference = leafEvaluation(position, player, settings);
+    if (depth == 0 || (player ? ScoreReference <= alpha : ScoreReference >= beta))
+        return ScoreReference;
+
+    /* Extra turns closest to the store first, they leave the other fields alone */
+    for (int j = 0; j < 6; j++)
+    {
+        uint8_t field = player ? 5 - j : 12 - j;
+        if (position[field] == 0 || moveKind(position, field, player) == MOVE_QUIET)
+            continue;
+        uint8_t PositionCopy[POSITION_SIZE];
+        memcpy(PositionCopy, position, POSITION_LENGTH);
+        bool next = move(PositionCopy, field, player);
+        int8_t score = quiescence(PositionCopy, next, depth - 1, player ? alpha : std::max(alpha, ScoreReference),
+            player ? std::min(beta, ScoreReference) : beta, settings, context);
+        if (player)
+        {
+            ScoreReference = std::min(ScoreReference, score);
+            if (ScoreReference <= alpha)
+                break;
+        }
         else
-            std::cout << "DRAW!" << std::endl;
+        {
+            ScoreReference = std::max(ScoreReference, score);
+            if (ScoreReference >= beta)
+                break;
+        }
     }
-};
+    return ScoreReference;
+}
 
-int main()
+/* Whether a stored score has the sign of the game result, see "SearchContext::sure" */
+inline bool solvedSign(const TranspositionTable::Hit& hit, int8_t value)
 {
-    Environment game(Agent("player"), Agent("computer", 16), true);
-    //game.RandomizePosition();
-    game.start();
+    return hit.depth == TT_SOLVED && (hit.bound == TT_EXACT || (hit.bound == TT_LOWER && value > 0) || (hit.bound == TT_UPPER && value < 0));
+}
+
+/*
+    Whether a stored score of a child proves a win for "player", the side to move at its parent; the parent is at
+    least as good as the child for the mover, so only a bound on the mover's side carries over
+*/
+inline bool childWins(const TranspositionTable::Hit& hit, int8_t value, bool player)
+{
+    return hit.depth == TT_SOLVED && (player ? hit.bound != TT_LOWER && value < 0 : hit.bound != TT_UPPER && value > 0);
+}
+
+/* Narrow the window of a root child to the current multi-PV bounds */
+inline void refreshRootWindow(const SearchContext& context, int8_t& alpha, int8_t& beta, int8_t& originalAlpha, int8_t& originalBeta)
+{
+    int8_t low = (int8_t)context.bounds->alpha.load(std::memory_order_relaxed);
+    int8_t high = (int8_t)context.bounds->beta.load(std::memory_order_relaxed);
+    if (low > originalAlpha)
+        originalAlpha = alpha = std::max(alpha, low);
+    if (high < originalBeta)
+        originalBeta = beta = std::min(beta, high);
+}
+
+/*
+    Tree-Search
+    Adapted to work with variable turn orders.
+    Recursive.
+    Returns the static evaluation of its children.
+    Optimizing for root "player" call.
+    "ply" is the distance to the root of the thread's "context", the best line is left in its PV table.
+*/
+int8_t minimax(uint8_t* position, bool player, uint8_t depth, int8_t alpha, int8_t beta, const SearchSettings& settings,
+    SearchContext& context, uint8_t ply = 0)
+{
+    if ((settings.stop != nullptr && settings.stop->load(std::memory_order_relaxed))
+        || (context.decided != nullptr && context.decided->load(std::memory_order_relaxed)))
+    {
+        context.aborted = true;
+        context.sure = false;
+        return 0;
+    }
+    context.stats.nodes++;
+    if (ply < MAX_PLY)
+        context.pvLength[ply] = 0;
+
+    /* Branch terminating events */
+    /* If terminal return evaluation */
+    context.sure = true;
+    if (PlayerEmpty(position))
+    { 
+        for (int i = 7; i < 13; i++)
+            position[COMPUTER_SCORE] += position[i];
+        return Evaluation(position);
+    }
+    if (ComputerEmpty(position))
+    {
+        for (int i = 0; i < 6; i++)
+            position[PLAYER_SCORE] += position[i];
+        return Evaluation(position);
+    }
+    if (depth == 0)
+    {
+        context.horizon++;
+        /* The store difference has the sign of the result once a store holds more than half of the stones */
+        if (context.stones != 0 && std::max(position[PLAYER_SCORE], position[COMPUTER_SCORE]) * 2 > context.stones)
+            return Evaluation(position);
+        context.sure = false;
+        if (settings.quiescence > 0)
+            return quiescence(position, player, settings.quiescence, alpha, beta, settings, context);
+        return leafEvaluation(position, player, settings);
+    }
+
+    /* Transposition table, a stored score is used if it was searched deep enough and fits the window */
+    TranspositionTable* table = settings.table;
+    uint64_t key = 0;
+    int stores = 0;
+    uint8_t tableMove = 0xFF;
+    int8_t originalAlpha = alpha, originalBeta = beta;
+    if (table != nullptr)
+    {
+        key = positionKey(position, player);
+        stores = Evaluation(position);
+        TranspositionTable::Hit hit;
+        context.stats.tableProbes++;
+        if ((context.delta != nullptr && context.delta->Probe(key, hit)) || table->Probe(key, hit))
+        {
+            context.stats.tableHits++;
+            tableMove = hit.move;
+            int8_t value = (int8_t)std::max(-128, std::min(127, hit.score + stores));
+            if (hit.depth >= depth && (hit.bound == TT_EXACT || (hit.bound == TT_LOWER && value >= beta)
+                || (hit.bound == TT_UPPER && value <= alpha)))
+            {
+                context.horizon += hit.depth != TT_SOLVED;
+                context.sure = solvedSign(hit, value);
+                return value;
+            }
+        }
+    }
+    uint64_t horizon = context.horizon;
+
+    /*
+        Move ordering: the move of the previous principal variation, or the table move if there is none, then extra turns
+        closest to the store first (they leave the other fields alone), captures, the killer moves of this ply, the counter
+        to the move that led here and the other quiet moves
+    */
+    uint8_t order[6];
+    uint8_t kinds[6];
+    uint8_t count = 0;
+    uint8_t pvMove = 0xFF;
+    bool onPv = context.followPv;
+    if (onPv)
+    {
+        if (ply < context.previous->length && position[context.previous->moves[ply]] != 0)
+            order[count++] = pvMove = context.previous->moves[ply];
+        else
+            onPv = context.followPv = false;
+    }
+    if (pvMove == 0xFF && tableMove < 13 && (tableMove < 7) == player && position[tableMove] != 0)
+        order[count++] = pvMove = tableMove;
+    if (count > 0)
+        kinds[0] = moveKind(position, pvMove, player);
+    uint8_t fieldKinds[6];
+    for (int i = 0, first = player ? 0 : 7; i < 6; i++)
+        fieldKinds[i] = position[first + i] != 0 ? moveKind(position, first + i, player) : 0xFF;
+    for (int kind = MOVE_EXTRA; kind >= MOVE_QUIET; kind--)
+    {
+        if (kind == MOVE_QUIET && settings.killers && ply < MAX_PLY)
+        {
+            uint8_t candidates[3] = { context.killers[ply][0], context.killers[ply][1], ply > 0 ? context.counters[context.path[ply - 1]] : (uint8_t)0xFF };
+            for (uint8_t field : candidates)
+            {
+                uint8_t i = field - (player ? 0 : 7);
+                if (i >= 6 || fieldKinds[i] != MOVE_QUIET || field == pvMove)
+                    continue;
+                /* Taken, the plain quiet moves below skip it */
+                fieldKinds[i] = 0xFE;
+                kinds[count] = MOVE_QUIET;
+                order[count++] = field;
+            }
+        }
+        for (int j = 0; j < 6; j++)
+        {
+            int i = kind == MOVE_EXTRA ? 5 - j : j;
+            uint8_t field = (player ? 0 : 7) + i;
+            if (fieldKinds[i] != kind || field == pvMove)
+                continue;
+            kinds[count] = kind;
+            order[count++] = field;
+        }
+    }
+    uint8_t unit = settings.DepthUnit();
+    /* Forward pruning, the window is returned as the bound */
+    if (settings.probCut != nullptr && !onPv && ply > 1 && depth >= settings.probCut->minDepth * unit)
+    {
+        const ProbCutModel& model = *settings.probCut;
+        uint8_t shallow = (uint8_t)std::max<int>(unit, depth - model.reduction * unit);
+        uint8_t PositionCopy[POSITION_SIZE];
+        memcpy(PositionCopy, position, POSITION_LENGTH);
+        /* Shallow score that predicts a deep score beyond the window, probed with a null window */
+        if (player)
+        {
+            int bound = (int)std::floor((alpha - model.b - model.threshold * model.sigma) / model.a);
+            if (bound > -128 && bound < 127
+                && minimax(PositionCopy, player, shallow, (int8_t)bound, (int8_t)(bound + 1), settings, context, ply) <= bound)
+            {
+                /* A predicted bound is never exact, so the callers must not store it as solved */
+                context.horizon++;
+                context.sure = false;
+                return alpha;
+            }
+        }
+        else
+        {
+            int bound = (int)std::ceil((beta - model.b + model.threshold * model.sigma) / model.a);
+            if (bound > -127 && bound < 128
+                && minimax(PositionCopy, player, shallow, (int8_t)(bound - 1), (int8_t)bound, settings, context, ply) >= bound)
+            {
+                context.horizon++;
+                context.sure = false;
+                return beta;
+            }
+        }
+    }
+    if (settings.multiCutMoves > 0 && !onPv && ply > 1 && depth >= settings.multiCutDepth * unit)
+    {
+        int cuts = 0;
+        for (int k = 0; k < std::min<int>(count, settings.multiCutMoves); k++)
+        {
+            uint8_t PositionCopy[POSITION_SIZE];
+            memcpy(PositionCopy, position, POSITION_LENGTH);
+            bool next = move(PositionCopy, order[k], player);
+            uint8_t childDepth = settings.ChildDepth(depth, kinds[k]);
+            uint8_t reducedDepth = (uint8_t)std::max(childDepth - settings.multiCutReduction * unit, std::min<int>(childDepth, unit));
+            int8_t score = minimax(PositionCopy, next, reducedDepth, alpha, beta, settings, context, ply + 1);
+            if ((player ? score <= alpha : score >= beta) && ++cuts >= settings.multiCutCuts)
+            {
+                /* Reduced searches only, see ProbCut above */
+                context.horizon++;
+                context.sure = false;
+                return player ? alpha : beta;
+            }
+        }
+    }
+
+    /* Enhanced transposition cutoffs, a child whose stored bound already refutes this node saves searching the others */
+    if (settings.etc && table != nullptr && depth >= settings.etcDepth * settings.DepthUnit())
+    {
+        for (int k = 0; k < count; k++)
+        {
+            uint8_t PositionCopy[POSITION_SIZE];
+            memcpy(PositionCopy, position, POSITION_LENGTH);
+            bool next = move(PositionCopy, order[k], player);
+            if (PlayerEmpty(PositionCopy) || ComputerEmpty(PositionCopy))
+                continue;
+            context.stats.etcProbes++;
+            TranspositionTable::Hit hit;
+            uint64_t childKey = positionKey(PositionCopy, next);
+            if (!((context.delta != nullptr && context.delta->Probe(childKey, hit)) || table->Probe(childKey, hit))
+                || hit.depth < settings.ChildDepth(depth, kinds[k]))
+                continue;
+            int8_t value = (int8_t)std::max(-128, std::min(127, hit.score + (Evaluation(PositionCopy))));
+            if (player ? hit.bound != TT_LOWER && value <= alpha : hit.bound != TT_UPPER && value >= beta)
+            {
+                context.stats.etcCutoffs++;
+                context.horizon += hit.depth != TT_SOLVED;
+                context.sure = childWins(hit, value, player);
+                return value;
+            }
+        }
+    }
+    bool reduce = settings.lmrMoves > 0 && depth >= settings.lmrDepth * unit && depth > unit;
+
+    /* Extend branch */
+    /* Each possible move is a new child */
+    int8_t ScoreReference;
+    uint8_t bestField = order[0];
+    bool record = ply < MAX_PLY - 1;
+    /* Proofs: a proven winning child, every child proven, children left out by a cutoff */
+    bool winning = false, allSure = true, cut = false;
+    /* Maximize/Minimize evaluation depending on who is being optimized */
+    if (player)
+    {
+        /* Reference score is worst possible for lowest possible score */
+        ScoreReference = 127;
+        for (int k = 0; k < count; k++)
+        {
+            if (ply == 1 && context.bounds != nullptr)
+                refreshRootWindow(context, alpha, beta, originalAlpha, originalBeta);
+            /* Create independent duplicate of board "position" for child */
+            uint8_t PositionCopy[POSITION_SIZE];
+            memcpy(PositionCopy, position, POSITION_LENGTH);
+            /* Only the first child of a node on the previous line stays on it */
+            context.followPv = onPv && k == 0;
+            if (record)
+                context.path[ply] = order[k];
+            bool next = move(PositionCopy, order[k], player);
+            uint8_t childDepth = settings.ChildDepth(depth, kinds[k]);
+            /* The bucket of the child is on its way while the child checks for the end of the game */
+            if (table != nullptr && settings.prefetch && childDepth > 0)
+                table->Prefetch(positionKey(PositionCopy, next));
+            /* Recursive call, optimizing for whoever move returned next move too */
+            int8_t score;
+            if (reduce && k >= settings.lmrMoves && kinds[k] == MOVE_QUIET)
+            {
+                /* Late quiet move, a reduced search has to beat beta before it gets a full one */
+                uint8_t ReducedCopy[POSITION_SIZE];
+                memcpy(ReducedCopy, PositionCopy, POSITION_LENGTH);
+                uint8_t reducedDepth = (uint8_t)std::max(childDepth - settings.lmrReduction * unit, std::min<int>(childDepth, unit));
+                score = minimax(ReducedCopy, next, reducedDepth, alpha, beta, settings, context, ply + 1);
+                if (score < beta)
+                    score = minimax(PositionCopy, next, childDepth, alpha, beta, settings, context, ply + 1);
+            }
+            else
+                score = minimax(PositionCopy, next, childDepth, alpha, beta, settings, context, ply + 1);
+            winning |= context.sure && score < 0;
+            allSure &= context.sure;
+            if (score < ScoreReference || k == 0)
+            {
+                ScoreReference = score;
+                bestField = order[k];
+                if (record)
+                {
+                    context.pv[ply][0] = order[k];
+                    memcpy(&context.pv[ply][1], context.pv[ply + 1], context.pvLength[ply + 1]);
+                    context.pvLength[ply] = context.pvLength[ply + 1] + 1;
+                }
+            }
+            /* Alpha-Beta breakoff condition */
+            if (ScoreReference <= alpha)
+            {
+                if (kinds[k] == MOVE_QUIET)
+                    context.Cutoff(ply, order[k]);
+                cut = k + 1 < count;
+                break;
+            }
+            /* Update Beta value */
+            beta = std::min(ScoreReference, beta);
+        }      
+    }
+    else
+    {
+        /* Reference score is worst possible for highest possible score */
+        ScoreReference = -128;
+        for (int k = 0; k < count; k++)
+        {
+            if (ply == 1 && context.bounds != nullptr)
+                refreshRootWindow(context, alpha, beta, originalAlpha, originalBeta);
+            uint8_t PositionCopy[POSITION_SIZE];
+            memcpy(PositionCopy, position, POSITION_LENGTH);
+            context.followPv = onPv && k == 0;
+            if (record)
+                context.path[ply] = order[k];
+            bool next = move(PositionCopy, order[k], player);
+            uint8_t childDepth = settings.ChildDepth(depth, kinds[k]);
+            if (table != nullptr && settings.prefetch && childDepth > 0)
+                table->Prefetch(positionKey(PositionCopy, next));
+            int8_t score;
+            if (reduce && k >= settings.lmrMoves && kinds[k] == MOVE_QUIET)
+            {
+                uint8_t ReducedCopy[POSITION_SIZE];
+                memcpy(ReducedCopy, PositionCopy, POSITION_LENGTH);
+                uint8_t reducedDepth = (uint8_t)std::max(childDepth - settings.lmrReduction * unit, std::min<int>(childDepth, unit));
+                score = minimax(ReducedCopy, next, reducedDepth, alpha, beta, settings, context, ply + 1);
+                if (score > alpha)
+                    score = minimax(PositionCopy, next, childDepth, alpha, beta, settings, context, ply + 1);
+            }
+            else
+                score = minimax(PositionCopy, next, childDepth, alpha, beta, settings, context, ply + 1);
+            winning |= context.sure && score > 0;
+            allSure &= context.sure;
+            if (score > ScoreReference || k == 0)
+            {
+                ScoreReference = score;
+                bestField = order[k];
+                if (record)
+                {
+                    context.pv[ply][0] = order[k];
+                    memcpy(&context.pv[ply][1], context.pv[ply + 1], context.pvLength[ply + 1]);
+                    context.pvLength[ply] = context.pvLength[ply + 1] + 1;
+                }
+            }
+            
+            if (ScoreReference >= beta)
+            {
+                if (kinds[k] == MOVE_QUIET)
+                    context.Cutoff(ply, order[k]);
+                cut = k + 1 < count;
+                break;
+            }
+            alpha = std::max(ScoreReference, alpha);
+        }
+    }
+
+    /* A win needs one proven winning move, a loss or a draw needs all moves proven */
+    context.sure = (player ? ScoreReference < 0 : ScoreReference > 0) ? winning : !cut && allSure;
+
+    /* Results of a stopped search are not stored, their scores are made up */
+    if (table != nullptr && !context.aborted)
+    {
+        uint8_t bound = ScoreReference <= originalAlpha ? TT_UPPER : ScoreReference >= originalBeta ? TT_LOWER : TT_EXACT;
+        uint8_t stored = context.horizon == horizon ? TT_SOLVED : depth;
+        if (context.delta != nullptr)
+            context.delta->Store(key, ScoreReference - stores, stored, bound, bestField);
+        else
+            table->Store(key, ScoreReference - stores, stored, bound, bestField);
+    }
+
+    /* Return evaluation of children */
+    return ScoreReference;
+}
+
+/* Outcome of a root search, scores are Computer positive */
+struct SearchResult
+{
+    uint8_t bestMove = 0;
+    int8_t score = 0;
+    /* Score and principal variation of every root move, indexed by field % 7, empty fields keep the worst score for the side to move */
+    int8_t scores[6];
+    PvLine lines[6];
+    /* Scores of moves outside the "multiPv" best are bounds, they are worse than the last exact one by at least 1 */
+    bool exact[6] = {};
+    /* Same as "stats.nodes" */
+    uint64_t nodes = 0;
+    /* "TranspositionTable::Occupancy" after the search, 0 without a table */
+    double occupancy = 0.0;
+    /* Nodes of every root move, the cost estimate of the next iteration */
+    uint64_t moveNodes[6] = {};
+    SearchStats stats;
+    double seconds = 0.0;
+    /* Depth of the completed search, 0 if it was stopped */
+    uint8_t depth = 0;
+    /*
+        A root move was proven to win for the side to move and the search of the others was cut short: only the proven
+        moves compete for "bestMove", the cut ones keep the worst score and are not exact
+    */
+    bool decided = false;
+
+    const PvLine& Pv() const { return lines[bestMove % 7]; }
+};
+
+/* Continue "line" from the moves stored in "table" where the search cut it short */
+void extendPv(const uint8_t* position, bool player, PvLine& line, const TranspositionTable& table)
+{
+    uint8_t board[POSITION_SIZE];
+    memcpy(board, position, POSITION_LENGTH);
+    for (int i = 0; i < line.length; i++)
+        player = move(board, line.moves[i], player);
+    TranspositionTable::Hit hit;
+    while (line.length < MAX_PLY && !PlayerEmpty(board) && !ComputerEmpty(board)
+        && table.Probe(positionKey(board, player), hit))
+    {
+        if (hit.move > 12 || (hit.move < 7) != player || board[hit.move] == 0)
+            break;
+        line.moves[line.length++] = hit.move;
+        player = move(board, hit.move, player);
+    }
+}
+
+/*
+    Searches the replies of "position", the child of the root reached by "context.path[0]", on "helpers" + 1 threads.
+    The first reply is searched alone, the others are shared out afterwards and searched against the best score so far,
+    so the score is the one of the search on one thread. The principal variation goes to row 1 of "context".
+    The helpers are pinned to the cores from "helperCore" on, -1 = not pinned.
+*/
+int8_t splitReplies(uint8_t* position, bool player, uint8_t depth, int8_t alpha, int8_t beta, const SearchSettings& settings,
+    SearchContext& context, uint8_t helpers, int helperCore)
+{
+    context.stats.nodes++;
+    uint8_t order[6];
+    uint8_t count = 0;
+    uint8_t pvMove = 0xFF;
+    if (context.followPv && context.previous->length > 1 && position[context.previous->moves[1]] != 0)
+        order[count++] = pvMove = context.previous->moves[1];
+    context.followPv = pvMove != 0xFF;
+    for (int i = 0, first = player ? 0 : 7; i < 6; i++)
+        if (position[first + i] != 0 && first + i != pvMove)
+            order[count++] = first + i;
+
+    std::mutex mutex;
+    int8_t best = player ? 127 : -128;
+    PvLine line;
+    /* Proofs, see the end of "minimax" */
+    bool winning = false, allSure = true, cut = false;
+    auto searchReply = [&](SearchContext& local, uint8_t k)
+    {
+        int8_t low = alpha, high = beta;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (player)
+                high = std::min(high, best);
+            else
+                low = std::max(low, best);
+        }
+        if (local.bounds != nullptr)
+        {
+            low = std::max<int8_t>(low, (int8_t)local.bounds->alpha.load(std::memory_order_relaxed));
+            high = std::min<int8_t>(high, (int8_t)local.bounds->beta.load(std::memory_order_relaxed));
+        }
+        if (low >= high)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cut = true;
+            return;
+        }
+        uint8_t board[POSITION_SIZE];
+        memcpy(board, position, POSITION_LENGTH);
+        uint8_t kind = moveKind(board, order[k], player);
+        bool next = move(board, order[k], player);
+        local.path[1] = order[k];
+        int8_t value = minimax(board, next, settings.ChildDepth(depth, kind), low, high, settings, local, 2);
+        std::lock_guard<std::mutex> lock(mutex);
+        winning |= local.sure && (player ? value < 0 : value > 0);
+        allSure &= local.sure;
+        if (player ? value < best : value > best)
+        {
+            best = value;
+            line.moves[0] = order[k];
+            memcpy(&line.moves[1], local.pv[2], local.pvLength[2]);
+            line.length = local.pvLength[2] + 1;
+        }
+    };
+
+    searchReply(context, 0);
+    context.followPv = false;
+    std::atomic<uint8_t> nextReply{ 1 };
+    auto helper = [&](SearchContext& local)
+    {
+        for (uint8_t k = nextReply++; k < count; k = nextReply++)
+            searchReply(local, k);
+    };
+    std::vector<std::unique_ptr<SearchContext>> locals;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < std::min<int>(helpers, count - 1); i++)
+    {
+        locals.push_back(std::make_unique<SearchContext>());
+        SearchContext& local = *locals.back();
+        local.previous = context.previous;
+        local.bounds = context.bounds;
+        local.path[0] = context.path[0];
+        local.stones = context.stones;
+        local.decided = context.decided;
+        threads.emplace_back([&helper, &local, helperCore, i]()
+        {
+            if (helperCore >= 0)
+                pinThread(helperCore + i);
+            helper(local);
+        });
+    }
+    helper(context);
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+        context.stats += locals[i]->stats;
+        context.horizon += locals[i]->horizon;
+        context.aborted |= locals[i]->aborted;
+    }
+    context.sure = (player ? best < 0 : best > 0) ? winning : !cut && allSure;
+
+    memcpy(context.pv[1], line.moves, line.length);
+    context.pvLength[1] = line.length;
+    return best;
+}
+
+/* 
+    Function for individual threads to call, takes "firstMove" argument which determines which 
+    first branch the thread should search.
+    "line" holds the previous principal variation starting with "firstMove" and receives the new one.
+    "depth" is in internal units, see "SearchSettings::DepthUnit". "helpers" extra threads share the replies, see "splitReplies".
+    "proven" is set if the move wins for "player" whatever the horizon, "decided" is then set to end the other root moves.
+*/
+void minimaxThreadCall(int8_t* target, bool* exact, SearchStats* stats, uint8_t firstMove, uint8_t* position, bool player, uint8_t depth,
+    const SearchSettings* settings, PvLine* line, RootBounds* bounds, DeltaTable* delta, uint8_t helpers, int helperCore,
+    std::atomic<bool>* decided, bool* proven)
+{
+    SearchContext context;
+    context.delta = delta;
+    context.decided = decided;
+    for (int i = 0; i < POSITION_LENGTH; i++)
+        context.stones += position[i];
+    context.previous = line;
+    context.followPv = line->length > 1 && line->moves[0] == firstMove;
+    context.bounds = bounds;
+    context.path[0] = firstMove;
+    int8_t alpha = bounds != nullptr ? (int8_t)bounds->alpha.load() : -128;
+    int8_t beta = bounds != nullptr ? (int8_t)bounds->beta.load() : 127;
+    uint8_t PositionCopy[POSITION_SIZE];
+    memcpy(PositionCopy, position, POSITION_LENGTH * sizeof(uint8_t));
+    uint8_t kind = moveKind(PositionCopy, firstMove, player);
+    bool next = move(PositionCopy, firstMove, player);
+    uint8_t childDepth = settings->ChildDepth(depth, kind);
+    if (helpers > 0 && childDepth > 0 && !PlayerEmpty(PositionCopy) && !ComputerEmpty(PositionCopy))
+        *target = splitReplies(PositionCopy, next, childDepth, alpha, beta, *settings, context, helpers, helperCore);
+    else
+        *target = minimax(PositionCopy, next, childDepth, alpha, beta, *settings, context, 1);
+    if (context.aborted)
+        *target = player ? 127 : -128;
+    *exact = !context.aborted && (bounds == nullptr || bounds->Report(*target));
+    *proven = !context.aborted && context.sure && (player ? *target < 0 : *target > 0);
+    if (*proven && decided != nullptr)
+        decided->store(true);
+    *stats = context.stats;
+    line->moves[0] = firstMove;
+    memcpy(&line->moves[1], context.pv[1], context.pvLength[1]);
+    line->length = context.pvLength[1] + 1;
+}
+
+/* Size of the delta table of each root move in deterministic searches, entries that don't fit are lost */
+#define DELTA_MEGABYTES 1
+/* Root searches without a previous iteration estimate the root move subtrees with a search this many plies or turns shallower */
+#define BALANCE_PROBE_REDUCTION 4
+
+/*
+    Tree-Search root call, searches every root move "depth" plies or turns deep, "settings.threads" at a time.
+    The lines of "previous", the result of a shallower search of the same position, are searched first,
+    so passing each result of a deepening search to the next iteration orders it.
+    With "settings.multiPv" set only that many root moves get exact scores, see "RootBounds".
+    Nothing is printed, see "printSearch".
+*/
+SearchResult minimaxRoot(uint8_t* position, bool player, uint8_t depth, const SearchSettings& settings = SearchSettings(),
+    const SearchResult* previous = nullptr)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    /* Fixed depth callers have no previous iteration, the shallow search stands in for it and is counted in the stats */
+    SearchResult probe;
+    if (settings.balance && settings.threads > 1 && previous == nullptr && depth > BALANCE_PROBE_REDUCTION)
+    {
+        SearchSettings probeSettings = settings;
+        probeSettings.earlyStop = false;
+        probe = minimaxRoot(position, player, depth - BALANCE_PROBE_REDUCTION, probeSettings);
+        previous = &probe;
+    }
+    SearchResult result;
+    result.stats = probe.stats;
+    if (previous != nullptr)
+        memcpy(result.lines, previous->lines, sizeof(result.lines));
+    SearchStats stats[6];
+    int legal = 0;
+    for (int i = 0; i < 6; i++)
+        legal += position[player ? i : i + 7] != 0;
+    /* Asking for all moves or more is a plain search of all of them */
+    std::unique_ptr<RootBounds> bounds;
+    if (settings.multiPv > 0 && settings.multiPv < legal && !settings.deterministic)
+        bounds = std::make_unique<RootBounds>(settings.multiPv, player);
+    /* Below "TT_SOLVED" */
+    uint8_t units = (uint8_t)std::min(254, depth * settings.DepthUnit());
+    bool useDeltas = settings.deterministic && settings.table != nullptr;
+    DeltaTables local;
+    std::unique_ptr<DeltaTable>* deltas = settings.deltas != nullptr ? settings.deltas->moves : local.moves;
+    /* Not signalled in deterministic searches, which root moves are cut short would depend on the timing */
+    std::atomic<bool> decided{ false };
+    bool proven[6] = {};
+
+    /* Biggest subtrees of the previous iteration first, each spare thread goes to the root move with the most nodes per thread */
+    uint8_t tasks[6];
+    uint8_t helpers[6] = {};
+    int count = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        result.scores[i] = player ? 127 : -128;
+        if (position[player ? i : i + 7] == 0)
+            continue;
+        tasks[count++] = i;
+        if (useDeltas)
+        {
+            if (deltas[i] == nullptr)
+                deltas[i] = std::make_unique<DeltaTable>(DELTA_MEGABYTES);
+            else
+                deltas[i]->Clear();
+        }
+    }
+    if (settings.balance && previous != nullptr)
+    {
+        std::stable_sort(tasks, tasks + count, [previous](uint8_t a, uint8_t b) { return previous->moveNodes[a] > previous->moveNodes[b]; });
+        for (int spare = (int)settings.threads - count; spare > 0 && count > 0 && !settings.deterministic; spare--)
+        {
+            uint8_t biggest = *std::max_element(tasks, tasks + count, [previous, &helpers](uint8_t a, uint8_t b)
+                { return previous->moveNodes[a] / (helpers[a] + 1) < previous->moveNodes[b] / (helpers[b] + 1); });
+            if (previous->moveNodes[biggest] == 0)
+                break;
+            helpers[biggest]++;
+        }
+    }
+
+    /* Pinned workers take the first cores, the helpers of each root move the ones after them */
+    int poolSize = std::min<int>(std::max(1u, settings.threads), count);
+    int helperCores[6];
+    for (int i = 0, core = poolSize; i < 6; core += helpers[i++])
+        helperCores[i] = settings.pinThreads ? core : -1;
+    std::atomic<int> nextTask{ 0 };
+    std::vector<std::thread> workers;
+    for (int t = 0; t < poolSize; t++)
+        workers.emplace_back([&, t]()
+        {
+            if (settings.pinThreads)
+                pinThread(t);
+            for (int k = nextTask++; k < count; k = nextTask++)
+            {
+                uint8_t i = tasks[k];
+                minimaxThreadCall(&result.scores[i], &result.exact[i], &stats[i], player ? i : i + 7, position, player,
+                    units, &settings, &result.lines[i], bounds.get(), useDeltas ? deltas[i].get() : nullptr, helpers[i], helperCores[i],
+                    settings.deterministic || !settings.earlyStop ? nullptr : &decided, &proven[i]);
+            }
+        });
+    for (std::thread& worker : workers)
+        worker.join();
+    if (useDeltas)
+        for (int i = 0; i < 6; i++)
+            if (position[player ? i : i + 7] != 0)
+                deltas[i]->MergeInto(*settings.table);
+    if (settings.table != nullptr)
+        for (int i = 0; i < 6; i++)
+            if (position[player ? i : i + 7] != 0)
+                extendPv(position, player, result.lines[i], *settings.table);
+
+    /* Only a signalled proof cut the other root moves short, otherwise every move has its full score */
+    result.decided = decided.load();
+    result.score = player ? 127 : -128;
+    for (int i = 0; i < 6; i++)
+    {
+        result.stats += stats[i];
+        result.moveNodes[i] = stats[i].nodes;
+        if (position[player ? i : i + 7] == 0 || (result.decided && !proven[i]))
+            continue;
+        if (player && result.scores[i] < result.score)
+        {
+            result.score = result.scores[i];
+            result.bestMove = i;
+        }
+        else if (!player && result.scores[i] > result.score)
+        {
+            result.score = result.scores[i];
+            result.bestMove = i + 7;
+        }
+    }
+    result.nodes = result.stats.nodes;
+    if (settings.table != nullptr)
+        result.occupancy = settings.table->Occupancy();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (settings.stop == nullptr || !settings.stop->load())
+        result.depth = depth;
+    return result;
+}
+
+/* Print the board "position" */
+void print(unsigned char* position)
+{
+#ifdef _WIN32
+    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+    std::cout << "   < 0--1--2--3--4--5 >" << std::endl;
+    SetConsoleTextAttribute(hConsole, 4);
+    std::cout << std::setw(3) << +position[COMPUTER_SCORE];
+    SetConsoleTextAttribute(hConsole, 7);
+#else
+    std::cout << "   < 0--1--2--3--4--5 >" << std::endl;
+    std::cout << std::setw(3) << +position[COMPUTER_SCORE];
+#endif
+    for (int i = COMPUTER_SCORE - 1; i > PLAYER_SCORE; i--)
+        std::cout << std::setw(3) << + position[i];
+#ifdef _WIN32
+    SetConsoleTextAttribute(hConsole, 9);
+    std::cout << std::setw(3) << +position[PLAYER_SCORE] << std::endl << "   ";
+    SetConsoleTextAttribute(hConsole, 7);
+#else
+    std::cout << std::setw(3) << +position[PLAYER_SCORE] << std::endl << "   ";
+#endif
+    for (int i = 0; i < PLAYER_SCORE; i++)
+        std::cout << std::setw(3) << +position[i];
+    std::cout << std::endl;
+}
+
+/* Print the outcome of a search for "player", the side that searched, with up to "lines" exact root moves */
+void printSearch(const SearchResult& result, const uint8_t* position, bool player, uint8_t lines = 1)
+{
+    int score = player ? -result.score : result.score;
+#ifdef _WIN32
+    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+    std::cout << "Evaluation: ";
+    SetConsoleTextAttribute(hConsole, (result.score > 0) ? 4 : 9);
+    std::cout << score << std::endl;
+    SetConsoleTextAttribute(hConsole, 7);
+#else
+    std::cout << "Evaluation: " << score << std::endl;
+#endif
+    std::cout << "Principal variation: " << formatPv(result.Pv(), position) << std::endl;
+    if (lines > 1)
+    {
+        uint8_t order[6];
+        uint8_t count = 0;
+        for (int i = 0; i < 6; i++)
+            if (result.exact[i])
+                order[count++] = i;
+        std::stable_sort(order, order + count, [&](uint8_t a, uint8_t b)
+            { return player ? result.scores[a] < result.scores[b] : result.scores[a] > result.scores[b]; });
+        for (int i = 0; i < std::min(count, lines); i++)
+        {
+            const PvLine& line = result.lines[order[i]];
+            std::cout << std::setw(2) << i + 1 << ". " << std::setw(3) << (player ? -result.scores[order[i]] : +result.scores[order[i]])
+                << "  " << formatPv(line, position) << std::endl;
+        }
+    }
+    std::cout << "Depth " << +result.depth << ", " << result.nodes << " nodes in " << result.seconds * 1000.0 << "ms" << std::endl;
+    if (result.stats.tableProbes > 0)
+    {
+        /* Formatted on its own stream so the precision does not stick to std::cout */
+        std::ostringstream usage;
+        usage << std::setprecision(3) << result.stats.tableHits * 100.0 / result.stats.tableProbes << "% hits, "
+            << result.occupancy * 100.0 << "% full";
+        std::cout << "Transposition table: " << usage.str() << std::endl;
+    }
+    if (result.stats.etcProbes > 0)
+        std::cout << "Enhanced transposition cutoffs: " << result.stats.etcCutoffs << " of " << result.stats.etcProbes << " probes" << std::endl;
+}
+
+/*
+    Search memory
+    Tree searches allocate huge amounts of small nodes. Instead of "new" per node they use:
+        Arena       bump allocator over large blocks, one per search thread, released all at once with "Reset"
+        NodePool    contiguous node storage addressed by 32-bit indices, threads claim chunks of it
+                    and hand out nodes from their chunk without touching shared state
+    Both keep their memory between searches, so moves after the first one allocate nothing.
+*/
+class Arena
+{
+private:
+    struct Block
+    {
+        std::unique_ptr<uint8_t[]> memory;
+        size_t size;
+    };
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t current = 0;
+    size_t offset = 0;
+
+public:
+    explicit Arena(size_t blockSize = 1 << 20)
+        : blockSize(blockSize)
+    {}
+
+    void* Allocate(size_t size, size_t alignment)
+    {
+        while (true)
+        {
+            /* Oversized requests get a block of their own */
+            if (current == blocks.size())
+            {
+                size_t bytes = std::max(blockSize, size + alignment);
+                blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[bytes]), bytes });
+            }
+            Block& block = blocks[current];
+            uintptr_t base = (uintptr_t)block.memory.get();
+            size_t start = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+            if (start + size <= block.size)
+            {
+                offset = start + size;
+                return block.memory.get() + start;
+            }
+            current++;
+            offset = 0;
+        }
+    }
+
+    /* Only for types without destructor, nothing allocated here is ever destroyed */
+    template<typename T>
+    T* Allocate(size_t count = 1)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena memory is never destroyed");
+        T* memory = (T*)Allocate(sizeof(T) * count, alignof(T));
+        for (size_t i = 0; i < count; i++)
+            new (memory + i) T();
+        return memory;
+    }
+
+    /* Release everything at once, the blocks are kept for the next search */
+    void Reset()
+    {
+        current = 0;
+        offset = 0;
+    }
+
+    size_t Reserved() const
+    {
+        size_t bytes = 0;
+        for (const Block& block : blocks)
+            bytes += block.size;
+        return bytes;
+    }
+};
+
+#define POOL_NONE 0xFFFFFFFF
+#define POOL_CHUNK 256
+
+template<typename T>
+class NodePool
+{
+private:
+    std::unique_ptr<T[]> nodes;
+    uint32_t capacity;
+    std::atomic<uint32_t> used{ 0 };
+
+public:
+    /* Per thread allocation state, the chunk of the pool the thread currently hands out nodes from */
+    struct Cursor
+    {
+        uint32_t next = 0;
+        uint32_t end = 0;
+    };
+
+    explicit NodePool(uint32_t capacity)
+        : nodes(new T[capacity]), capacity(capacity)
+    {}
+
+    /* Returns the index of "count" consecutive nodes, or POOL_NONE if the pool is exhausted */
+    uint32_t Allocate(uint32_t count, Cursor& cursor)
+    {
+        if (cursor.end - cursor.next < count)
+        {
+            /* Only claims what is left, so "used" never passes "capacity" and exhaustion stays final */
+            uint32_t first = used.load(std::memory_order_relaxed), chunk;
+            do
+            {
+                if (capacity - first < count)
+                    return POOL_NONE;
+                chunk = std::min(std::max<uint32_t>(count, POOL_CHUNK), capacity - first);
+            } while (!used.compare_exchange_weak(first, first + chunk, std::memory_order_relaxed));
+            cursor.next = first;
+            cursor.end = first + chunk;
+        }
+        uint32_t first = cursor.next;
+        cursor.next += count;
+        return first;
+    }
+
+    T& operator[](uint32_t index) { return nodes[index]; }
+    const T& operator[](uint32_t index) const { return nodes[index]; }
+
+    /* Release every node at once, cursors of the previous search have to be discarded too */
+    void Reset() { used.store(0, std::memory_order_relaxed); }
+
+    uint32_t Used() const { return used.load(std::memory_order_relaxed); }
+    uint32_t Capacity() const { return capacity; }
+};
+
+/*
+    Random playouts
+    Single games are played with "move", the batched engine below plays many games at once.
+*/
+/* xorshift64, one state per thread */
+inline uint64_t nextRandom(uint64_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+/* Play random moves until the game ends, returns the final store difference (Computer positive) */
+int8_t randomPlayout(uint8_t* position, bool player, uint64_t& rng)
+{
+    while (!PlayerEmpty(position) && !ComputerEmpty(position))
+    {
+        uint8_t fields[6];
+        uint8_t count = 0;
+        for (int i = player ? 0 : 7, end = i + 6; i < end; i++)
+            if (position[i] > 0)
+                fields[count++] = i;
+        player = move(position, fields[nextRandom(rng) % count], player);
+    }
+    for (int i = 0; i < 6; i++)
+        position[PLAYER_SCORE] += position[i];
+    for (int i = 7; i < 13; i++)
+        position[COMPUTER_SCORE] += position[i];
+    return Evaluation(position);
+}
+
+/*
+    Batched playout engine
+    Boards are stored as structure-of-arrays in blocks of PLAYOUT_LANES games: pits[field][lane].
+    Every step plays one random move in every unfinished game of a block at the same time.
+    Sowing is branch free: a move of "count" stones gives every field of the sowing ring count / 13 stones,
+    plus one to the first count % 13 fields behind the selected one. Finished games are masked out.
+    Without SSE2 every lane is played with "move" instead.
+*/
+#define PLAYOUT_LANES 16
+
+struct PlayoutBlock
+{
+    alignas(16) uint8_t pits[POSITION_LENGTH][PLAYOUT_LANES];
+    /* 0xFF if "Player" is to move */
+    alignas(16) uint8_t turn[PLAYOUT_LANES];
+    /* 0xFF while the game is running */
+    alignas(16) uint8_t active[PLAYOUT_LANES];
+    alignas(16) uint8_t selection[PLAYOUT_LANES];
+    uint32_t rng[PLAYOUT_LANES];
+};
+
+class PlayoutEngine
+{
+private:
+    /* Either owned or taken from an arena */
+    std::vector<PlayoutBlock> owned;
+    PlayoutBlock* blocks;
+    size_t blockCount;
+    uint32_t games;
+
+    /* Pick a random non empty field for every active lane and take its stones */
+    void select(PlayoutBlock& block, uint8_t* count)
+    {
+        for (int lane = 0; lane < PLAYOUT_LANES; lane++)
+        {
+            count[lane] = 0;
+            if (!block.active[lane])
+                continue;
+            uint32_t& state = block.rng[lane];
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            uint8_t first = block.turn[lane] ? 0 : 7;
+            uint8_t options = 0;
+            for (int i = 0; i < 6; i++)
+                options += block.pits[first + i][lane] > 0;
+            uint8_t pick = state % options;
+            uint8_t field = first;
+            for (int i = 0; i < 6; i++)
+            {
+                if (block.pits[first + i][lane] > 0 && pick-- == 0)
+                {
+                    field = first + i;
+                    break;
+                }
+            }
+            block.selection[lane] = field;
+        }
+    }
+
+#ifdef MANCALA_SSE2
+    void step(PlayoutBlock& block)
+    {
+        alignas(16) uint8_t count[PLAYOUT_LANES], laps[PLAYOUT_LANES], rest[PLAYOUT_LANES], ring[PLAYOUT_LANES];
+        select(block, count);
+        for (int lane = 0; lane < PLAYOUT_LANES; lane++)
+        {
+            if (!block.active[lane])
+            {
+                laps[lane] = rest[lane] = ring[lane] = 0;
+                continue;
+            }
+            uint8_t field = block.selection[lane];
+            count[lane] = block.pits[field][lane];
+            block.pits[field][lane] = 0;
+            laps[lane] = count[lane] / 13;
+            rest[lane] = count[lane] % 13;
+            /* Position in the sowing ring, which starts at the movers first field and leaves out the enemy "Score" field */
+            ring[lane] = block.turn[lane] ? field : (field + 7) % POSITION_LENGTH;
+        }
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i thirteen = _mm_set1_epi8(13);
+        __m128i active = _mm_load_si128((__m128i*)block.active);
+        __m128i turn = _mm_load_si128((__m128i*)block.turn);
+        __m128i lapsV = _mm_load_si128((__m128i*)laps);
+        __m128i restV = _mm_load_si128((__m128i*)rest);
+        __m128i ringV = _mm_load_si128((__m128i*)ring);
+        /* Ring distance of the last sown field, a multiple of 13 ends on the selected field itself */
+        __m128i last = _mm_or_si128(restV, _mm_and_si128(_mm_cmpeq_epi8(restV, zero), thirteen));
+
+        __m128i landing[POSITION_LENGTH];
+        for (int j = 0; j < POSITION_LENGTH; j++)
+        {
+            __m128i fieldRing = _mm_or_si128(_mm_and_si128(turn, _mm_set1_epi8(j)),
+                _mm_andnot_si128(turn, _mm_set1_epi8((j + 7) % POSITION_LENGTH)));
+            __m128i valid = _mm_andnot_si128(_mm_cmpeq_epi8(fieldRing, thirteen), active);
+            /* Distance behind the selected field, 1 to 13 */
+            __m128i distance = _mm_sub_epi8(fieldRing, ringV);
+            distance = _mm_add_epi8(distance, _mm_and_si128(_mm_cmplt_epi8(distance, zero), thirteen));
+            distance = _mm_or_si128(distance, _mm_and_si128(_mm_cmpeq_epi8(distance, zero), thirteen));
+            __m128i reached = _mm_cmpeq_epi8(_mm_min_epu8(distance, restV), distance);
+            __m128i stones = _mm_add_epi8(lapsV, _mm_and_si128(reached, one));
+            __m128i* pits = (__m128i*)block.pits[j];
+            _mm_store_si128(pits, _mm_add_epi8(_mm_load_si128(pits), _mm_and_si128(stones, valid)));
+            landing[j] = _mm_and_si128(_mm_cmpeq_epi8(distance, last), valid);
+        }
+
+        /* Captures, the last stone landed in an empty own field and the opposite field has stones */
+        __m128i* playerScore = (__m128i*)block.pits[PLAYER_SCORE];
+        __m128i* computerScore = (__m128i*)block.pits[COMPUTER_SCORE];
+        for (int j = 0; j < 13; j++)
+        {
+            if (j == PLAYER_SCORE)
+                continue;
+            __m128i own = j < 6 ? turn : _mm_xor_si128(turn, _mm_set1_epi8(-1));
+            __m128i* pits = (__m128i*)block.pits[j];
+            __m128i* opposite = (__m128i*)block.pits[12 - j];
+            __m128i field = _mm_load_si128(pits);
+            __m128i stolen = _mm_load_si128(opposite);
+            __m128i capture = _mm_and_si128(_mm_and_si128(landing[j], own), _mm_cmpeq_epi8(field, one));
+            capture = _mm_andnot_si128(_mm_cmpeq_epi8(stolen, zero), capture);
+            __m128i* score = j < 6 ? playerScore : computerScore;
+            _mm_store_si128(score, _mm_add_epi8(_mm_load_si128(score), _mm_and_si128(capture, _mm_add_epi8(stolen, one))));
+            _mm_store_si128(pits, _mm_andnot_si128(capture, field));
+            _mm_store_si128(opposite, _mm_andnot_si128(capture, stolen));
+        }
+
+        /* Extra turn if the last stone landed in the own "Score" field, otherwise the turn switches */
+        __m128i extra = _mm_or_si128(_mm_and_si128(landing[PLAYER_SCORE], turn), _mm_andnot_si128(turn, landing[COMPUTER_SCORE]));
+        turn = _mm_xor_si128(turn, _mm_andnot_si128(extra, active));
+        _mm_store_si128((__m128i*)block.turn, turn);
+
+        /* Games where one side is empty end, remaining stones go to their owners "Score" field */
+        __m128i playerSide = zero, computerSide = zero;
+        for (int j = 0; j < 6; j++)
+        {
+            playerSide = _mm_or_si128(playerSide, _mm_load_si128((__m128i*)block.pits[j]));
+            computerSide = _mm_or_si128(computerSide, _mm_load_si128((__m128i*)block.pits[j + 7]));
+        }
+        __m128i finished = _mm_and_si128(active,
+            _mm_or_si128(_mm_cmpeq_epi8(playerSide, zero), _mm_cmpeq_epi8(computerSide, zero)));
+        for (int j = 0; j < 6; j++)
+        {
+            __m128i* pits = (__m128i*)block.pits[j];
+            _mm_store_si128(playerScore, _mm_add_epi8(_mm_load_si128(playerScore), _mm_and_si128(_mm_load_si128(pits), finished)));
+            _mm_store_si128(pits, _mm_andnot_si128(finished, _mm_load_si128(pits)));
+            pits = (__m128i*)block.pits[j + 7];
+            _mm_store_si128(computerScore, _mm_add_epi8(_mm_load_si128(computerScore), _mm_and_si128(_mm_load_si128(pits), finished)));
+            _mm_store_si128(pits, _mm_andnot_si128(finished, _mm_load_si128(pits)));
+        }
+        _mm_store_si128((__m128i*)block.active, _mm_andnot_si128(finished, active));
+    }
+#else
+    void step(PlayoutBlock& block)
+    {
+        uint8_t count[PLAYOUT_LANES];
+        select(block, count);
+        for (int lane = 0; lane < PLAYOUT_LANES; lane++)
+        {
+            if (!block.active[lane])
+                continue;
+            uint8_t position[POSITION_SIZE] = {};
+            for (int j = 0; j < POSITION_LENGTH; j++)
+                position[j] = block.pits[j][lane];
+            bool player = block.turn[lane] != 0;
+            player = move(position, block.selection[lane], player);
+            if (PlayerEmpty(position) || ComputerEmpty(position))
+            {
+                for (int j = 0; j < 6; j++)
+                {
+                    position[PLAYER_SCORE] += position[j];
+                    position[COMPUTER_SCORE] += position[j + 7];
+                    position[j] = position[j + 7] = 0;
+                }
+                block.active[lane] = 0;
+            }
+            for (int j = 0; j < POSITION_LENGTH; j++)
+                block.pits[j][lane] = position[j];
+            block.turn[lane] = player ? 0xFF : 0;
+        }
+    }
+#endif
+
+public:
+    PlayoutEngine(const PlayoutEngine&) = delete;
+    PlayoutEngine& operator=(const PlayoutEngine&) = delete;
+
+    PlayoutEngine(uint32_t games, uint64_t seed, Arena* arena = nullptr)
+        : blockCount((games + PLAYOUT_LANES - 1) / PLAYOUT_LANES), games(games)
+    {
+        if (arena != nullptr)
+            blocks = arena->Allocate<PlayoutBlock>(blockCount);
+        else
+        {
+            owned.resize(blockCount);
+            blocks = owned.data();
+        }
+        for (size_t b = 0; b < blockCount; b++)
+        {
+            memset(&blocks[b], 0, sizeof(PlayoutBlock));
+            for (int lane = 0; lane < PLAYOUT_LANES; lane++)
+                blocks[b].rng[lane] = (uint32_t)nextRandom(seed) | 1;
+        }
+    }
+
+    uint32_t Games() const { return games; }
+
+    /* Set up game "game", a finished position is scored right away */
+    void Load(uint32_t game, const uint8_t* position, bool player)
+    {
+        PlayoutBlock& block = blocks[game / PLAYOUT_LANES];
+        int lane = game % PLAYOUT_LANES;
+        for (int j = 0; j < POSITION_LENGTH; j++)
+            block.pits[j][lane] = position[j];
+        block.turn[lane] = player ? 0xFF : 0;
+        block.active[lane] = 0xFF;
+        if (PlayerEmpty(position) || ComputerEmpty(position))
+        {
+            for (int j = 0; j < 6; j++)
+            {
+                block.pits[PLAYER_SCORE][lane] += block.pits[j][lane];
+                block.pits[COMPUTER_SCORE][lane] += block.pits[j + 7][lane];
+                block.pits[j][lane] = block.pits[j + 7][lane] = 0;
+            }
+            block.active[lane] = 0;
+        }
+    }
+
+    /* Set up every game with the same position */
+    void Fill(const uint8_t* position, bool player)
+    {
+        for (uint32_t game = 0; game < games; game++)
+            Load(game, position, player);
+    }
+
+    /* Play all games to the end in lockstep, returns the amount of steps taken */
+    uint32_t Run()
+    {
+        uint32_t steps = 0;
+        for (size_t b = 0; b < blockCount; b++)
+        {
+            PlayoutBlock& block = blocks[b];
+            uint32_t blockSteps = 0;
+            while (true)
+            {
+                uint64_t running;
+                memcpy(&running, block.active, 8);
+                uint64_t upper;
+                memcpy(&upper, block.active + 8, 8);
+                if ((running | upper) == 0)
+                    break;
+                step(block);
+                blockSteps++;
+            }
+            steps = std::max(steps, blockSteps);
+        }
+        return steps;
+    }
+
+    /* Single step of every block, used to check the engine against "move" */
+    void Step()
+    {
+        for (size_t b = 0; b < blockCount; b++)
+            step(blocks[b]);
+    }
+
+    /* Board and side to move of game "game" */
+    bool Position(uint32_t game, uint8_t* position) const
+    {
+        const PlayoutBlock& block = blocks[game / PLAYOUT_LANES];
+        for (int j = 0; j < POSITION_LENGTH; j++)
+            position[j] = block.pits[j][game % PLAYOUT_LANES];
+        return block.turn[game % PLAYOUT_LANES] != 0;
+    }
+
+    uint8_t Selection(uint32_t game) const { return blocks[game / PLAYOUT_LANES].selection[game % PLAYOUT_LANES]; }
+    bool Active(uint32_t game) const { return blocks[game / PLAYOUT_LANES].active[game % PLAYOUT_LANES] != 0; }
+
+    /* Final store difference of a finished game (Computer positive) */
+    int8_t Result(uint32_t game) const
+    {
+        const PlayoutBlock& block = blocks[game / PLAYOUT_LANES];
+        int lane = game % PLAYOUT_LANES;
+        return (int8_t)(block.pits[COMPUTER_SCORE][lane] - block.pits[PLAYER_SCORE][lane]);
+    }
+};
+
+/*
+    Checks the engine against "move" for "games" random games and measures games per second
+    of the batched engine and of single "randomPlayout" calls.
+*/
+void playoutBench(uint32_t games)
+{
+    uint8_t start[POSITION_SIZE] = { 4,4,4,4,4,4,0,4,4,4,4,4,4,0 };
+    uint64_t seed = 0x9E3779B97F4A7C15;
+
+    /* Every step of every game has to match "move" */
+    PlayoutEngine check(std::min<uint32_t>(games, 4096), seed);
+    check.Fill(start, true);
+    uint32_t mismatches = 0, checkedMoves = 0;
+    std::vector<uint8_t> before(check.Games() * POSITION_SIZE);
+    std::vector<uint8_t> turns(check.Games());
+    bool running = true;
+    while (running)
+    {
+        for (uint32_t game = 0; game < check.Games(); game++)
+            turns[game] = check.Position(game, &before[game * POSITION_SIZE]);
+        std::vector<uint8_t> wasActive(check.Games());
+        for (uint32_t game = 0; game < check.Games(); game++)
+            wasActive[game] = check.Active(game);
+        check.Step();
+        running = false;
+        for (uint32_t game = 0; game < check.Games(); game++)
+        {
+            if (!wasActive[game])
+                continue;
+            running = true;
+            uint8_t* expected = &before[game * POSITION_SIZE];
+            bool player = turns[game] != 0;
+            player = move(expected, check.Selection(game), player);
+            if (PlayerEmpty(expected) || ComputerEmpty(expected))
+            {
+                for (int j = 0; j < 6; j++)
+                {
+                    expected[PLAYER_SCORE] += expected[j];
+                    expected[COMPUTER_SCORE] += expected[j + 7];
+                    expected[j] = expected[j + 7] = 0;
+                }
+            }
+            uint8_t actual[POSITION_SIZE];
+            bool actualPlayer = check.Position(game, actual);
+            if (memcmp(expected, actual, POSITION_LENGTH) != 0 || (actualPlayer != player && check.Active(game)))
+                mismatches++;
+            checkedMoves++;
+        }
+    }
+    std::cout << "Checked " << checkedMoves << " moves against move(): " << mismatches << " mismatches" << std::endl;
+
+    PlayoutEngine engine(games, seed);
+    engine.Fill(start, true);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    engine.Run();
+    double batched = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    int64_t checksum = 0;
+    for (uint32_t game = 0; game < games; game++)
+        checksum += engine.Result(game);
+
+    begin = std::chrono::steady_clock::now();
+    for (uint32_t game = 0; game < games; game++)
+    {
+        uint8_t position[POSITION_SIZE];
+        memcpy(position, start, POSITION_LENGTH);
+        checksum += randomPlayout(position, true, seed);
+    }
+    double single = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "Batched: " << (uint64_t)(games / batched) << " games/s" << std::endl;
+    std::cout << "Single:  " << (uint64_t)(games / single) << " games/s" << std::endl;
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+}
+
+/* Statistics tool: win rates of every first move of the start position from "games" random playouts each */
+void playoutWinRates(uint32_t games, uint8_t stones)
+{
+    uint8_t start[POSITION_SIZE] = { stones,stones,stones,stones,stones,stones,0,stones,stones,stones,stones,stones,stones,0 };
+    PlayoutEngine engine(games, std::random_device{}());
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    uint64_t played = 0;
+    for (uint8_t field = 0; field < 6; field++)
+    {
+        uint8_t position[POSITION_SIZE];
+        memcpy(position, start, POSITION_LENGTH);
+        bool player = true;
+        player = move(position, field, player);
+        engine.Fill(position, player);
+        engine.Run();
+        uint32_t wins = 0, draws = 0;
+        for (uint32_t game = 0; game < games; game++)
+        {
+            int8_t result = engine.Result(game);
+            wins += result < 0;
+            draws += result == 0;
+        }
+        played += games;
+        std::ostringstream rates;
+        rates << std::fixed << std::setprecision(1) << 100.0 * wins / games << "% wins, " << 100.0 * draws / games << "% draws";
+        std::cout << "Move " << +field << ": " << rates.str() << std::endl;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << (uint64_t)(played / seconds) << " games/s" << std::endl;
+}
+
+/*
+    Monte Carlo Tree Search
+    UCT selection over one tree shared by all threads (tree parallelism).
+    A thread passing through a node adds a virtual loss to it until its playout is backed up,
+    which steers the other threads into different branches.
+    Playouts are uniformly random games played with "move".
+    Node results are counted from the view of the side that moved into the node: 2 points per win, 1 per draw.
+*/
+#define MCTS_MAX_PATH 256
+
+struct MctsNode
+{
+    std::atomic<uint32_t> visits;
+    std::atomic<uint32_t> virtualLoss;
+    std::atomic<uint32_t> points;
+    /* 0 = leaf, 1 = being expanded, 2 = expanded */
+    std::atomic<uint8_t> state;
+    uint8_t childCount;
+    uint8_t field;
+    /* Side that played "field" to reach this node */
+    bool mover;
+    /* Indices into the node pool */
+    uint32_t children[6];
+
+    void reset(uint8_t selected, bool side)
+    {
+        visits.store(0, std::memory_order_relaxed);
+        virtualLoss.store(0, std::memory_order_relaxed);
+        points.store(0, std::memory_order_relaxed);
+        state.store(0, std::memory_order_relaxed);
+        childCount = 0;
+        field = selected;
+        mover = side;
+    }
+};
+
+/* Node pool shared by all search threads plus one scratch arena per thread, both reset for every search */
+struct MctsTree
+{
+    NodePool<MctsNode> nodes;
+    std::vector<Arena> arenas;
+
+    MctsTree(uint32_t capacity)
+        : nodes(capacity)
+    {}
+};
+
+struct MctsSettings
+{
+    /* Stop after this many playouts, 0 = no limit */
+    uint32_t playouts = 100000;
+    /* Stop after this many milliseconds, 0 = no limit */
+    uint32_t timeLimit = 0;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    /* UCT exploration constant */
+    double exploration = 1.4;
+    /* Playouts per leaf with the batched engine, 0 = one playout with "randomPlayout" */
+    uint32_t batch = 0;
+};
+
+struct MctsResult
+{
+    uint8_t field;
+    uint32_t playouts;
+    uint32_t nodes;
+    double winRate;
+};
+
+/* Selection, expansion, playout and backup until a limit is hit, run by every search thread */
+void mctsWorker(MctsTree* tree, Arena* arena, const uint8_t* root, bool rootPlayer, const MctsSettings* settings,
+    std::atomic<uint32_t>* playouts, std::atomic<bool>* stop, std::chrono::steady_clock::time_point deadline, uint64_t seed)
+{
+    NodePool<MctsNode>& pool = tree->nodes;
+    NodePool<MctsNode>::Cursor cursor;
+    uint64_t rng = seed | 1;
+    uint32_t* path = arena->Allocate<uint32_t>(MCTS_MAX_PATH);
+    uint32_t perLeaf = std::max(1u, settings->batch);
+    std::unique_ptr<PlayoutEngine> engine;
+    if (settings->batch > 0)
+        engine = std::make_unique<PlayoutEngine>(settings->batch, seed, arena);
+
+    while (!stop->load(std::memory_order_relaxed))
+    {
+        uint32_t done = playouts->fetch_add(perLeaf, std::memory_order_relaxed);
+        if (settings->playouts != 0 && done >= settings->playouts)
+            break;
+        if (settings->timeLimit != 0 && (done / perLeaf & 63) == 0 && std::chrono::steady_clock::now() >= deadline)
+        {
+            stop->store(true, std::memory_order_relaxed);
+            break;
+        }
+
+        uint8_t position[POSITION_SIZE];
+        memcpy(position, root, POSITION_LENGTH);
+        bool player = rootPlayer;
+        uint32_t index = 0;
+        int length = 0;
+
+        /* Selection, virtual loss on every node of the path */
+        while (true)
+        {
+            MctsNode& node = pool[index];
+            node.virtualLoss.fetch_add(1, std::memory_order_relaxed);
+            path[length++] = index;
+            if (PlayerEmpty(position) || ComputerEmpty(position) || length == MCTS_MAX_PATH)
+                break;
+
+            /* Expand a leaf on its second visit, whoever wins the state change does the work */
+            uint8_t state = node.state.load(std::memory_order_acquire);
+            if (state == 0 && node.visits.load(std::memory_order_relaxed) > 0 && node.state.compare_exchange_strong(state, 1))
+            {
+                uint8_t fields[6];
+                uint8_t count = 0;
+                for (int i = player ? 0 : 7, end = i + 6; i < end; i++)
+                    if (position[i] > 0)
+                        fields[count++] = i;
+                uint32_t first = pool.Allocate(count, cursor);
+                if (first == POOL_NONE)
+                {
+                    /* Pool is full, the node stays a leaf for the rest of the search */
+                    break;
+                }
+                for (uint8_t i = 0; i < count; i++)
+                {
+                    pool[first + i].reset(fields[i], player);
+                    node.children[i] = first + i;
+                }
+                node.childCount = count;
+                node.state.store(2, std::memory_order_release);
+            }
+            else if (state != 2)
+                break;
+
+            /* UCT, unvisited children first */
+            double logParent = std::log((double)node.visits.load(std::memory_order_relaxed) + node.virtualLoss.load(std::memory_order_relaxed));
+            uint32_t best = node.children[0];
+            double bestValue = -1.0;
+            for (uint8_t i = 0; i < node.childCount; i++)
+            {
+                MctsNode& child = pool[node.children[i]];
+                uint32_t visits = child.visits.load(std::memory_order_relaxed) + child.virtualLoss.load(std::memory_order_relaxed);
+                if (visits == 0)
+                {
+                    best = node.children[i];
+                    break;
+                }
+                double value = child.points.load(std::memory_order_relaxed) / (2.0 * visits)
+                    + settings->exploration * std::sqrt(logParent / visits);
+                if (value > bestValue)
+                {
+                    bestValue = value;
+                    best = node.children[i];
+                }
+            }
+            player = move(position, pool[best].field, player);
+            index = best;
+        }
+
+        /* Points for "Player" and "Computer" */
+        uint32_t points[2] = { 0, 0 };
+        if (engine != nullptr)
+        {
+            engine->Fill(position, player);
+            engine->Run();
+            for (uint32_t game = 0; game < engine->Games(); game++)
+            {
+                int8_t result = engine->Result(game);
+                points[0] += result == 0 ? 1 : (result < 0 ? 2 : 0);
+                points[1] += result == 0 ? 1 : (result > 0 ? 2 : 0);
+            }
+        }
+        else
+        {
+            int8_t result = randomPlayout(position, player, rng);
+            points[0] = result == 0 ? 1 : (result < 0 ? 2 : 0);
+            points[1] = result == 0 ? 1 : (result > 0 ? 2 : 0);
+        }
+
+        /* Backup, replacing the virtual loss with the real result */
+        for (int i = 0; i < length; i++)
+        {
+            MctsNode& node = pool[path[i]];
+            node.points.fetch_add(points[node.mover ? 0 : 1], std::memory_order_relaxed);
+            node.visits.fetch_add(perLeaf, std::memory_order_relaxed);
+            node.virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+/* MCTS root call, returns the most visited first move */
+MctsResult mctsRoot(MctsTree& tree, uint8_t* position, bool player, const MctsSettings& settings)
+{
+    NodePool<MctsNode>& pool = tree.nodes;
+    pool.Reset();
+    NodePool<MctsNode>::Cursor cursor;
+    uint32_t root = pool.Allocate(1, cursor);
+    /* The root is played by the side that is not to move, so its children are scored for "player" */
+    pool[root].reset(0, !player);
+    if (tree.arenas.size() < settings.threads)
+        tree.arenas.resize(settings.threads);
+    for (Arena& arena : tree.arenas)
+        arena.Reset();
+
+    std::atomic<uint32_t> playouts{ 0 };
+    std::atomic<bool> stop{ false };
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(settings.timeLimit);
+    uint64_t seed = std::random_device{}();
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < settings.threads; i++)
+        workers.emplace_back(mctsWorker, &tree, &tree.arenas[i], position, player, &settings, &playouts, &stop, deadline, seed * (i + 1) + i);
+    mctsWorker(&tree, &tree.arenas[0], position, player, &settings, &playouts, &stop, deadline, seed);
+    for (std::thread& worker : workers)
+        worker.join();
+
+    MctsResult result = { 0, 0, pool.Used(), 0.0 };
+    MctsNode& node = pool[root];
+    /* Root never got expanded when the limits allowed only a single playout */
+    if (node.state.load() != 2)
+    {
+        for (int i = player ? 0 : 7, end = i + 6; i < end; i++)
+            if (position[i] > 0)
+                result.field = i;
+        return result;
+    }
+    uint32_t mostVisits = 0;
+    for (uint8_t i = 0; i < node.childCount; i++)
+    {
+        MctsNode& child = pool[node.children[i]];
+        uint32_t visits = child.visits.load();
+        result.playouts += visits;
+        if (visits >= mostVisits)
+        {
+            mostVisits = visits;
+            result.field = child.field;
+            result.winRate = visits > 0 ? child.points.load() / (2.0 * visits) : 0.0;
+        }
+    }
+    return result;
+}
+
+/*
+    Depth schedule
+    Search depth as a function of the game phase: the stones still in the fields (in buckets of
+    SCHEDULE_BUCKET stones) and the amount of legal moves. Sparse endgames get deep searches, dense openings
+    shallow ones. Tables are made by "depth-calibrate" for a target time per move.
+*/
+#define SCHEDULE_BUCKET 4
+#define SCHEDULE_BUCKETS 32
+
+struct DepthSchedule
+{
+    /* 0 = not calibrated, "Depth" falls back to the agents fixed depth */
+    uint8_t depths[SCHEDULE_BUCKETS][7] = {};
+
+    static int Bucket(const uint8_t* position)
+    {
+        int stones = 0;
+        for (int i = 0; i < 6; i++)
+            stones += position[i] + position[i + 7];
+        return std::min(stones / SCHEDULE_BUCKET, SCHEDULE_BUCKETS - 1);
+    }
+
+    static int LegalMoves(const uint8_t* position, bool player)
+    {
+        int moves = 0;
+        for (int i = player ? 0 : 7, end = i + 6; i < end; i++)
+            moves += position[i] > 0;
+        return moves;
+    }
+
+    uint8_t Depth(const uint8_t* position, bool player, uint8_t fallback) const
+    {
+        uint8_t depth = depths[Bucket(position)][LegalMoves(position, player)];
+        return depth > 0 ? depth : fallback;
+    }
+
+    /* Text file with one "bucket moves depth" line per calibrated entry */
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path);
+        int bucket, moves, depth, entries = 0;
+        while (file >> bucket >> moves >> depth)
+        {
+            if (bucket < 0 || bucket >= SCHEDULE_BUCKETS || moves < 1 || moves > 6 || depth < 1 || depth > 255)
+                return false;
+            depths[bucket][moves] = (uint8_t)depth;
+            entries++;
+        }
+        return entries > 0;
+    }
+
+    bool Save(const std::string& path) const
+    {
+        std::ofstream file(path, std::ios::trunc);
+        for (int bucket = 0; bucket < SCHEDULE_BUCKETS; bucket++)
+            for (int moves = 1; moves <= 6; moves++)
+                if (depths[bucket][moves] > 0)
+                    file << bucket << " " << moves << " " << +depths[bucket][moves] << std::endl;
+        return (bool)file;
+    }
+};
+
+/*
+    Time management
+    A clock holds the remaining time of one side and the increment it gets after every move.
+    The per move budget is the remaining time spread over the moves the game is expected to last, which is
+    estimated from the stones still in the fields. Iterative deepening then works against two limits:
+        soft    no new iteration is started once half of it is used, it grows while the best move or the score
+                of the best move keep changing between iterations and shrinks while they are stable
+        hard    the search is stopped in the middle of an iteration, the previous iteration's move is played
+    A move that is the only legal one is played without searching, a move clearly ahead of all others after
+    TIME_CLEAR_DEPTH plies ends the search early.
+*/
+#define TIME_CLEAR_DEPTH 8
+#define TIME_CLEAR_MARGIN 8
+#define TIME_SWING 3
+
+struct Clock
+{
+    /* Seconds, 0 = no time control */
+    double remaining = 0.0;
+    double increment = 0.0;
+};
+
+class TimeManager
+{
+private:
+    double budget;
+    double soft;
+    double hard;
+    uint8_t lastMove = 0xFF;
+    int lastScore = 0;
+    int stableIterations = 0;
+    int clearIterations = 0;
+
+public:
+    TimeManager(const Clock& clock, const uint8_t* position)
+    {
+        int stones = 0;
+        for (int i = 0; i < 6; i++)
+            stones += position[i] + position[i + 7];
+        /* Roughly every second move of a side empties a field, dense positions have more moves ahead */
+        double movesLeft = std::max(4.0, std::min(30.0, stones / 3.0));
+        budget = clock.remaining / movesLeft + clock.increment * 0.8;
+        soft = budget;
+        /* Keep a reserve so a single move can never use up the whole clock */
+        hard = std::min(clock.remaining * 0.5 + clock.increment * 0.8, budget * 4.0);
+        soft = std::min(soft, hard);
+    }
+
+    double HardLimit() const { return hard; }
+
+    /* Called after every finished iteration, returns whether the next one should be started */
+    bool Continue(uint8_t depth, uint8_t bestMove, int bestScore, int secondScore, double elapsed)
+    {
+        if (lastMove != 0xFF)
+        {
+            bool changed = bestMove != lastMove;
+            bool swing = std::abs(bestScore - lastScore) >= TIME_SWING;
+            if (changed || swing)
+            {
+                stableIterations = 0;
+                soft = std::min(hard, soft * (changed ? 1.5 : 1.25));
+            }
+            else if (++stableIterations >= 3)
+                soft = std::max(budget * 0.5, soft * 0.9);
+        }
+        lastMove = bestMove;
+        lastScore = bestScore;
+
+        /* Clearly best for two iterations in a row */
+        if (depth >= TIME_CLEAR_DEPTH && bestScore - secondScore >= TIME_CLEAR_MARGIN)
+        {
+            if (++clearIterations >= 2)
+                return false;
+        }
+        else
+            clearIterations = 0;
+
+        /* The next iteration costs a multiple of this one */
+        return elapsed < soft * 0.5;
+    }
+};
+
+/* Sets "stop" once "seconds" have passed, unless it is cancelled before */
+class StopTimer
+{
+private:
+    std::mutex mutex;
+    std::condition_variable cancelled;
+    bool done = false;
+    std::thread thread;
+
+public:
+    StopTimer(std::atomic<bool>& stop, double seconds)
+    {
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+            + std::chrono::microseconds((int64_t)(seconds * 1e6));
+        thread = std::thread([this, &stop, deadline]()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!cancelled.wait_until(lock, deadline, [this]() { return done; }))
+                stop.store(true, std::memory_order_relaxed);
+        });
+    }
+
+    ~StopTimer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        cancelled.notify_one();
+        thread.join();
+    }
+};
+
+/* 
+Agent class
+Stores agent settings and contains move function for each type
+Types:
+    Random Agent = "random"
+    Human Player Agent = "player"
+    Minimax Agent = "computer"
+    Time Managed Minimax Agent = "timed" (iterative deepening against the game clock, depth limited without one)
+    Monte Carlo Tree Search Agent = "mcts"
+    Greedy N-tuple Agent = "greedy" (one move lookahead with the n-tuple evaluation, for self-play training)
+*/
+class Agent
+{
+private:
+    std::string type;
+    uint8_t depth;
+    bool verbose = true;
+    SearchSettings search;
+    /* Shared so copies of the agent don't duplicate the weights */
+    std::shared_ptr<const NTupleNetwork> network;
+    std::shared_ptr<const LinearEvaluation> linear;
+    /* Phase dependent depth, fixed "depth" if nullptr */
+    std::shared_ptr<const DepthSchedule> schedule;
+    /* Set by the game loop before every move, searches by time instead of depth while it has time left */
+    Clock clock;
+    /* Deepen until this many nodes are searched instead of searching to "depth", 0 = off */
+    uint64_t nodeBudget = 0;
+    MctsSettings mcts;
+    /* Shared so copies of the agent don't duplicate the node storage */
+    std::shared_ptr<MctsTree> mctsTree;
+    uint32_t mctsNodes = 1 << 20;
+    /* Shared by copies of the agent, its entries are valid for both sides */
+    std::shared_ptr<TranspositionTable> table;
+    /* Delta tables of deterministic searches, shared like "table" */
+    std::shared_ptr<DeltaTables> deltas;
+    std::shared_ptr<const ProbCutModel> probCut;
+    /* Chance of a random move of the greedy agent */
+    double exploration = 0.0;
+    std::mt19937 rng{ std::random_device{}() };
+    /* Time spent in "Move" */
+    double thinkTime = 0.0;
+    double longestMove = 0.0;
+    uint32_t moveCount = 0;
+    /* Iterative deepening until the time manager ends the search */
+    uint8_t timedSearch(uint8_t* board, bool turn)
+    {
+        uint8_t fields[6];
+        uint8_t count = 0;
+        for (int i = turn ? 0 : 7, end = i + 6; i < end; i++)
+            if (board[i] > 0)
+                fields[count++] = i;
+        if (count == 1)
+        {
+            if (verbose)
+                std::cout << "Forced move" << std::endl;
+            return fields[0];
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        TimeManager manager(clock, board);
+        std::atomic<bool> stop{ false };
+        SearchSettings settings = search;
+        settings.stop = &stop;
+        StopTimer timer(stop, manager.HardLimit());
+
+        uint8_t best = fields[0];
+        /* Each iteration starts with the lines of the one before */
+        SearchResult result;
+        for (int iteration = 1; iteration <= 100; iteration++)
+        {
+            SearchResult next = minimaxRoot(board, turn, (uint8_t)iteration, settings, &result);
+            if (next.depth == 0)
+                break;
+            result = next;
+            best = result.bestMove;
+
+            /* Best and second best score from the view of the side to move */
+            int bestScore = -128, secondScore = -128;
+            for (uint8_t i = 0; i < count; i++)
+            {
+                int score = turn ? -result.scores[fields[i] % 7] : result.scores[fields[i] % 7];
+                if (score > bestScore)
+                {
+                    secondScore = bestScore;
+                    bestScore = score;
+                }
+                else if (score > secondScore)
+                    secondScore = score;
+            }
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (verbose)
+                std::cout << "Depth " << iteration << ": move " << (turn ? best : 12 - best) << ", evaluation " << bestScore
+                    << " (" << (int)(elapsed * 1000.0) << "ms, " << result.nodes << " nodes) " << formatPv(result.Pv(), board) << std::endl;
+            if (result.decided || !manager.Continue((uint8_t)iteration, best, bestScore, secondScore, elapsed))
+                break;
+        }
+        return best;
+    }
+
+    /* Iterative deepening until the searched nodes reach "nodeBudget", the last iteration is finished */
+    SearchResult budgetSearch(uint8_t* board, bool turn)
+    {
+        SearchResult result;
+        uint64_t nodes = 0;
+        for (int iteration = 1; iteration * search.DepthUnit() <= 254 && nodes < nodeBudget && !result.decided; iteration++)
+        {
+            result = minimaxRoot(board, turn, (uint8_t)iteration, search, &result);
+            nodes += result.nodes;
+        }
+        result.nodes = nodes;
+        return result;
+    }
+
+public:
+    Agent(std::string type)
+        : type(type), depth(12)
+    {}
+
+    Agent(std::string type, uint8_t depth)
+        : type(type), depth(depth)
+    {}
+
+    /* MCTS limits, a value of 0 disables that limit */
+    Agent& SetPlayouts(uint32_t playouts) { mcts.playouts = playouts; return *this; }
+    Agent& SetTimeLimit(uint32_t milliseconds) { mcts.timeLimit = milliseconds; return *this; }
+    Agent& SetThreads(unsigned threads) { mcts.threads = std::max(1u, threads); return *this; }
+    Agent& SetPlayoutBatch(uint32_t games) { mcts.batch = games; return *this; }
+    Agent& SetVerbose(bool enabled) { verbose = enabled; return *this; }
+
+    Agent& SetExploration(double chance) { exploration = chance; return *this; }
+    Agent& SetSeed(uint32_t seed) { rng.seed(seed); return *this; }
+
+    /* Minimax leaf evaluation, nullptr for the store difference */
+    Agent& SetNetwork(std::shared_ptr<const NTupleNetwork> weights)
+    {
+        network = weights;
+        search.network = network.get();
+        return *this;
+    }
+
+    Agent& SetClock(const Clock& time) { clock = time; return *this; }
+
+    Agent& SetSchedule(std::shared_ptr<const DepthSchedule> depths)
+    {
+        schedule = depths;
+        return *this;
+    }
+
+    Agent& SetLinear(std::shared_ptr<const LinearEvaluation> weights)
+    {
+        linear = weights;
+        search.linear = linear.get();
+        return *this;
+    }
+
+    /*
+        Transposition table of "megabytes" size, 0 searches without one, see "Table memory" for "pages" and "numa".
+        An existing table is resized, copies of the agent share it.
+    */
+    Agent& SetHash(size_t megabytes, uint8_t pages = TT_PAGES_HUGE, uint8_t numa = TT_NUMA_LOCAL)
+    {
+        if (table != nullptr && megabytes > 0)
+            table->Resize(megabytes);
+        else
+            table = megabytes > 0 ? std::make_shared<TranspositionTable>(megabytes, pages, numa) : nullptr;
+        search.table = table.get();
+        return *this;
+    }
+
+    /* Root moves with an exact score, 0 = all of them */
+    Agent& SetMultiPv(uint8_t lines) { search.multiPv = lines; return *this; }
+
+    /* See "Depth semantics", costs are in quarter plies */
+    Agent& SetDepthMode(uint8_t mode, uint8_t extraCost = 2, uint8_t captureCost = 3)
+    {
+        search.depthMode = mode;
+        search.extraCost = extraCost;
+        search.captureCost = captureCost;
+        return *this;
+    }
+
+    Agent& SetNodeBudget(uint64_t nodes) { nodeBudget = nodes; return *this; }
+
+    Agent& SetEtc(bool enabled) { search.etc = enabled; return *this; }
+
+    Agent& SetDeterministic(bool enabled)
+    {
+        search.deterministic = enabled;
+        if (enabled && deltas == nullptr)
+            deltas = std::make_shared<DeltaTables>();
+        search.deltas = deltas.get();
+        return *this;
+    }
+
+    Agent& SetPinning(bool enabled) { search.pinThreads = enabled; return *this; }
+
+    /* Forward pruning, see "SearchSettings" */
+    Agent& SetMultiCut(uint8_t moves, uint8_t cuts = 2, uint8_t reduction = 2)
+    {
+        search.multiCutMoves = moves;
+        search.multiCutCuts = cuts;
+        search.multiCutReduction = reduction;
+        return *this;
+    }
+
+    Agent& SetProbCut(std::shared_ptr<const ProbCutModel> model)
+    {
+        probCut = model;
+        search.probCut = probCut.get();
+        return *this;
+    }
+
+    /* Plies of captures and extra turns below the horizon, 0 = off */
+    Agent& SetQuiescence(uint8_t plies) { search.quiescence = plies; return *this; }
+
+    /* Late move reductions, see "SearchSettings" */
+    Agent& SetReductions(uint8_t moves, uint8_t reduction = 1, uint8_t minDepth = 3)
+    {
+        search.lmrMoves = moves;
+        search.lmrReduction = reduction;
+        search.lmrDepth = minDepth;
+        return *this;
+    }
+
+    const std::string& Type() const { return type; }
+
+    /* Type and the settings that tell agents of the same type apart */
+    std::string Describe() const
+    {
+        std::string options = (network != nullptr ? ", n-tuple" : linear != nullptr ? ", linear" : "")
+            + std::string(search.lmrMoves > 0 ? ", reductions" : "")
+            + std::string(search.quiescence > 0 ? ", quiescence" : "")
+            + std::string(search.multiCutMoves > 0 ? ", multi-cut" : "") + std::string(probCut != nullptr ? ", probcut" : "")
+            + std::string(search.depthMode == DEPTH_TURNS ? ", turns" : search.depthMode == DEPTH_FRACTIONAL ? ", fractional" : "")
+            + std::string(search.deterministic ? ", deterministic" : "");
+        if (type == "timed")
+            return type + (options.empty() ? "" : "(" + options.substr(2) + ")");
+        if (type == "computer")
+            return type + (nodeBudget > 0 ? "(" + std::to_string(nodeBudget) + " nodes" : schedule != nullptr ? "(scheduled depth"
+                : "(depth " + std::to_string(depth)) + options + ")";
+        if (type == "mcts")
+            return type + "(" + std::to_string(mcts.playouts) + " playouts, " + std::to_string(mcts.timeLimit) + "ms)";
+        return type;
+    }
+    double AverageMoveTime() const { return moveCount > 0 ? thinkTime / moveCount : 0.0; }
+    double LongestMoveTime() const { return longestMove; }
+
+    void Move(uint8_t* board, bool& turn)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        /* Entries of the earlier moves are replaced first */
+        if (table != nullptr)
+            table->Age();
+        /* Minimax with time control */
+        if (type == "timed" && clock.remaining > 0.0)
+        {
+            uint8_t cacheResult = timedSearch(board, turn);
+            if (verbose)
+                std::cout << "Calculated move: " << (turn ? cacheResult : 12 - cacheResult) << std::endl;
+            turn = move(board, cacheResult, turn);
+        }
+        /* Minimax */
+        else if (type == "computer" || type == "timed")
+        {
+            uint8_t searchDepth = schedule != nullptr ? schedule->Depth(board, turn, depth) : depth;
+            SearchResult result = nodeBudget > 0 ? budgetSearch(board, turn) : minimaxRoot(board, turn, searchDepth, search);
+            uint8_t cacheResult = result.bestMove;
+            if (verbose)
+            {
+                printSearch(result, board, turn, search.multiPv);
+                std::cout << "Calculated move: " << (turn ? cacheResult : 12 - cacheResult) << std::endl;
+            }
+            turn = move(board, cacheResult, turn);
+        }
+        /* Monte Carlo Tree Search */
+        else if (type == "mcts")
+        {
+            if (mctsTree == nullptr)
+                mctsTree = std::make_shared<MctsTree>(mctsNodes);
+            MctsResult result = mctsRoot(*mctsTree, board, turn, mcts);
+            if (verbose)
+            {
+                std::ostringstream rate;
+                rate << std::setprecision(3) << result.winRate;
+                std::cout << "MCTS move: " << (turn ? result.field : 12 - result.field) << " (" << result.playouts
+                    << " playouts, win rate " << rate.str() << ")" << std::endl;
+            }
+            turn = move(board, result.field, turn);
+        }
+        /* Greedy, reads the weights with atomic loads so it can play while a trainer updates them */
+        else if (type == "greedy")
+        {
+            uint8_t fields[6];
+            uint8_t count = 0;
+            for (int i = turn ? 0 : 7, end = i + 6; i < end; i++)
+                if (board[i] > 0)
+                    fields[count++] = i;
+            uint8_t selection = fields[rng() % count];
+            if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) >= exploration)
+            {
+                float best = 0.0f;
+                for (uint8_t i = 0; i < count; i++)
+                {
+                    uint8_t PositionCopy[POSITION_SIZE];
+                    memcpy(PositionCopy, board, POSITION_LENGTH);
+                    bool next = turn;
+                    move(PositionCopy, fields[i], next);
+                    float value;
+                    if (PlayerEmpty(PositionCopy) || ComputerEmpty(PositionCopy))
+                    {
+                        for (int j = 0; j < 6; j++)
+                        {
+                            PositionCopy[PLAYER_SCORE] += PositionCopy[j];
+                            PositionCopy[COMPUTER_SCORE] += PositionCopy[j + 7];
+                        }
+                        value = Evaluation(PositionCopy);
+                    }
+                    else
+                        value = Evaluation(PositionCopy) + (network != nullptr ? network->SharedValue(PositionCopy) : 0.0f);
+                    /* Player minimizes, Computer maximizes */
+                    if (turn)
+                        value = -value;
+                    if (i == 0 || value > best)
+                    {
+                        best = value;
+                        selection = fields[i];
+                    }
+                }
+            }
+            if (verbose)
+                std::cout << "Greedy move: " << (turn ? selection : 12 - selection) << std::endl;
+            turn = move(board, selection, turn);
+        }
+        /* Human player */
+        else if (type == "player")
+        {
+            std::string input;
+            uint8_t inputMove;
+            std::cout << "Move:";
+            std::cin >> input;
+            inputMove = stoi(input);
+            if (0 <= inputMove && inputMove < 6 && board[turn ? inputMove : 12 - inputMove] > 0)
+                turn = move(board, turn ? inputMove : 12 - inputMove, turn);
+            else
+                std::cout << "Invalid Input!" << std::endl;
+        }
+        /* Random */
+        else
+        {
+            std::srand((unsigned int)std::time(nullptr));
+            while (true)
+            {
+                uint8_t selection = std::rand() % 6;
+                if (board[turn ? selection : 12 - selection] > 0)
+                {
+                    if (verbose)
+                        std::cout << "Random move: " << +selection << std::endl;
+                    turn = move(board, turn ? selection : 12 - selection, turn);
+                    break;
+                }
+            }
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        thinkTime += elapsed;
+        longestMove = std::max(longestMove, elapsed);
+        moveCount++;
+    }
+};
+
+/*
+    Game loop container
+    Supports random position, custom start position, start selection
+    and all combinations of different agents playing against each other
+*/
+class Environment
+{
+private:
+    bool turn;
+    Agent agent1;
+    Agent agent2;
+    bool verbose = true;
+    /* Called with the position and side to move after every move */
+    std::function<void(const uint8_t*, bool)> observer;
+    /* Game clocks of agent 1 and 2, no time control if the remaining time is 0 */
+    Clock clocks[2];
+    uint8_t position[POSITION_SIZE]
+    {
+        4,4,4,4,4,4,
+        0,
+        4,4,4,4,4,4,
+        0
+    };
+
+public:
+    /* "board" is copied, the caller keeps ownership */
+    Environment(Agent player1, Agent player2, bool playerStart, const uint8_t board[])
+        : turn(playerStart), agent1(player1), agent2(player2)
+    {
+        memcpy(position, board, POSITION_LENGTH);
+    }
+    
+    Environment(Agent player1, Agent player2, bool playerStart)
+        : turn(playerStart), agent1(player1), agent2(player2)
+    {}
+
+    Environment(Agent player1, Agent player2)
+        : turn(true), agent1(player1), agent2(player2)
+    {}
+
+private:
+    /* Randomize position with "StoneCount" amount of stones per side */
+    void p_RandomizePosition(uint8_t StoneCount, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+
+        for (int i = 0; i < POSITION_LENGTH; i++)
+            position[i] = 0;
+
+        for (int i = 0; i < StoneCount; i++)
+            position[rng() % 6] += 1;
+
+        for (int i = 0; i < 6; i++)
+            position[PLAYER_SCORE + i + 1] = position[i];
+    }
+
+public:
+    void RandomizePosition()
+    { 
+        p_RandomizePosition(4 * 6, (uint32_t)std::time(nullptr));
+    }
+    void RandomizePosition(uint8_t stoneCount)
+    {
+        p_RandomizePosition(stoneCount, (uint32_t)std::time(nullptr));
+    }
+    /* Reproducible, for generating many positions per second */
+    void RandomizePosition(uint8_t stoneCount, uint32_t seed)
+    {
+        p_RandomizePosition(stoneCount, seed);
+    }
+
+    /* Disable all console output of the game loop and both agents */
+    void SetVerbose(bool enabled)
+    {
+        verbose = enabled;
+        agent1.SetVerbose(enabled);
+        agent2.SetVerbose(enabled);
+    }
+
+    /* Give both agents "seconds" for the whole game plus "increment" after each of their moves */
+    void SetClock(double seconds, double increment)
+    {
+        clocks[0] = clocks[1] = { seconds, increment };
+    }
+
+    void SetObserver(std::function<void(const uint8_t*, bool)> callback)
+    {
+        observer = callback;
+    }
+
+    const Agent& Agent1() const { return agent1; }
+    const Agent& Agent2() const { return agent2; }
+
+    /* Start game loop, returns the final store difference from the view of agent 1 */
+    int start()
+    {
+        /*
+        Check for too many stones, warning at > 127, not 255 since the evaluation is int8_t 
+        so if not using minimax everything until 255 should work
+        */
+        int count = 0;
+        for (int i = 0; i < POSITION_LENGTH; i++)
+            count += position[i];
+        if (count > 127 && verbose)
+            std::cout << "[WARNING]: Too many stones on field! -> Risk of variable overflow!" << std::endl;
+
+        if (verbose)
+            print(position);
+        while (!PlayerEmpty(position) && !ComputerEmpty(position))
+        {
+            if (verbose)
+                std::cout << " <----<---<-<>->--->---->" << std::endl;
+ 
+            Clock& clock = clocks[turn ? 0 : 1];
+            bool timed = clock.remaining > 0.0;
+            std::chrono::steady_clock::time_point moveStart = std::chrono::steady_clock::now();
+            if (turn)
+            {
+                if (verbose)
+                    std::cout << "AGENT 1" << std::endl;
+                agent1.SetClock(clock).Move(position, turn);
+            } 
+            else
+            {
+                if (verbose)
+                    std::cout << "AGENT 2" << std::endl;
+                agent2.SetClock(clock).Move(position, turn);
+            }
+            if (timed)
+            {
+                clock.remaining -= std::chrono::duration<double>(std::chrono::steady_clock::now() - moveStart).count();
+                /* Running out of time is not a loss, the agent just continues with the increment only */
+                if (clock.remaining <= 0.0 && verbose)
+                    std::cout << "[WARNING]: Agent ran out of time!" << std::endl;
+                clock.remaining = std::max(clock.remaining, 0.001) + clock.increment;
+                if (verbose)
+                {
+                    std::ostringstream remaining;
+                    remaining << std::fixed << std::setprecision(2) << clocks[0].remaining << "s / " << clocks[1].remaining << "s";
+                    std::cout << "Clock: " << remaining.str() << std::endl;
+                }
+            }
+
+            if (observer)
+                observer(position, turn);
+            if (verbose)
+                print(position);
+        }
+
+        if (PlayerEmpty(position))
+        {
+            for (int i = 7; i < 13; i++)
+            {
+                position[COMPUTER_SCORE] += position[i];
+                position[i] = 0;
+            }
+        }
+
+        if (ComputerEmpty(position))
+        {
+            for (int i = 0; i < 6; i++)
+            {
+                position[PLAYER_SCORE] += position[i];
+                position[i] = 0;
+            }
+        }
+
+        if (!verbose)
+            return position[PLAYER_SCORE] - position[COMPUTER_SCORE];
+
+        std::cout << " <----<---<-<>->--->---->" << std::endl;
+        print(position);
+
+        if (position[PLAYER_SCORE] > position[COMPUTER_SCORE])
+            std::cout << "AGENT 1 WON" << std::endl;
+        else if (position[PLAYER_SCORE] < position[COMPUTER_SCORE])
+            std::cout << "AGENT 2 WON" << std::endl;
+        else
+            std::cout << "DRAW!" << std::endl;
+        return position[PLAYER_SCORE] - position[COMPUTER_SCORE];
+    }
+};
+
+/* Play "plies" random moves from the start position */
+void randomOpening(uint8_t* opening, bool& turn, std::mt19937& rng, int plies)
+{
+    const uint8_t start[POSITION_SIZE] = { 4,4,4,4,4,4,0,4,4,4,4,4,4,0 };
+    memcpy(opening, start, POSITION_SIZE);
+    turn = true;
+    for (int ply = 0; ply < plies && !PlayerEmpty(opening) && !ComputerEmpty(opening); ply++)
+    {
+        uint8_t selection;
+        do
+            selection = (turn ? 0 : 7) + rng() % 6;
+        while (opening[selection] == 0);
+        turn = move(opening, selection, turn);
+    }
+}
+
+/*
+    Self-play match: every opening is played twice with swapped sides.
+    Openings are a few random moves from the start position, generated from "seed" so runs are comparable.
+*/
+void selfPlayMatch(const Agent& agentA, const Agent& agentB, int openings, uint32_t seed, double clock = 0.0, double increment = 0.0)
+{
+    std::mt19937 rng(seed);
+    int wins = 0, draws = 0, losses = 0;
+    double timeA = 0.0, timeB = 0.0, longestA = 0.0, longestB = 0.0;
+
+    for (int game = 0; game < openings * 2; game++)
+    {
+        /* Same opening for both games of a pair */
+        if (game % 2 == 0)
+            rng.seed(seed + game);
+        uint8_t opening[POSITION_SIZE];
+        bool turn;
+        randomOpening(opening, turn, rng, 2);
+
+        bool aFirst = game % 2 == 0;
+        Environment environment(aFirst ? agentA : agentB, aFirst ? agentB : agentA, turn, opening);
+        environment.SetVerbose(false);
+        environment.SetClock(clock, increment);
+        int result = environment.start();
+        if (!aFirst)
+            result = -result;
+
+        if (result > 0)
+            wins++;
+        else if (result < 0)
+            losses++;
+        else
+            draws++;
+        timeA += (aFirst ? environment.Agent1() : environment.Agent2()).AverageMoveTime();
+        timeB += (aFirst ? environment.Agent2() : environment.Agent1()).AverageMoveTime();
+        longestA = std::max(longestA, (aFirst ? environment.Agent1() : environment.Agent2()).LongestMoveTime());
+        longestB = std::max(longestB, (aFirst ? environment.Agent2() : environment.Agent1()).LongestMoveTime());
+
+        std::cout << "\rGame " << game + 1 << "/" << openings * 2 << ": +" << wins << " =" << draws << " -" << losses << std::flush;
+    }
+    std::cout << std::endl << agentA.Describe() << " vs " << agentB.Describe() << ": " << wins << " wins, " << draws << " draws, "
+        << losses << " losses" << std::endl;
+    std::cout << "Average move time: " << agentA.Describe() << " " << timeA / (openings * 2) * 1000.0 << "ms, "
+        << agentB.Describe() << " " << timeB / (openings * 2) * 1000.0 << "ms" << std::endl;
+    std::cout << "Longest move: " << agentA.Describe() << " " << longestA * 1000.0 << "ms, "
+        << agentB.Describe() << " " << longestB * 1000.0 << "ms" << std::endl;
+}
+
+/* Inference speed of "network" over random positions and its self-play result against the store difference */
+void ntupleMatch(std::shared_ptr<const NTupleNetwork> network, uint8_t depth, uint8_t plainDepth, int openings)
+{
+    const int positions = 4096;
+    std::vector<uint8_t> boards(positions * POSITION_SIZE);
+    std::mt19937 rng(1);
+    for (int p = 0; p < positions; p++)
+        for (int i = 0; i < POSITION_LENGTH; i++)
+            boards[p * POSITION_SIZE + i] = (i == PLAYER_SCORE || i == COMPUTER_SCORE) ? rng() % 24 : rng() % 12;
+
+    int64_t checksum = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int round = 0; round < 256; round++)
+        for (int p = 0; p < positions; p++)
+            checksum += network->Evaluate(&boards[p * POSITION_SIZE]);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+#ifdef MANCALA_AVX2
+    const char* path = CpuHasAvx2 ? "AVX2 gathers" : "scalar, no AVX2 on this CPU";
+#else
+    const char* path = "scalar, not an x64 build";
+#endif
+    std::cout << "Evaluation: " << seconds * 1e9 / (256.0 * positions) << "ns per position, " << path << " (checksum " << checksum << ")" << std::endl;
+
+    Agent withNetwork("computer", depth);
+    withNetwork.SetNetwork(network);
+    selfPlayMatch(withNetwork, Agent("computer", plainDepth), openings, 1);
+}
+
+/*
+    TD(lambda) trainer for the n-tuple evaluation
+    Every thread plays greedy self-play games through the "Environment" loop and updates the shared tables
+    without locks after each game. Targets are lambda-returns computed backwards from the final store difference,
+    the prediction is the store difference plus the table sum.
+*/
+struct TdSettings
+{
+    uint64_t games = 100000;
+    float learningRate = 0.1f;
+    float lambda = 0.7f;
+    double exploration = 0.1;
+    /* Save the weights every this many games */
+    uint64_t checkpoint = 10000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+void tdWorker(NTupleNetwork* network, std::shared_ptr<const NTupleNetwork> shared, const TdSettings* settings,
+    std::atomic<uint64_t>* games, std::atomic<uint64_t>* samples, std::atomic<double>* loss, uint32_t seed)
+{
+    Agent agent("greedy");
+    agent.SetNetwork(shared).SetExploration(settings->exploration);
+    std::vector<uint8_t> states;
+    std::vector<float> values;
+
+    while (games->fetch_add(1, std::memory_order_relaxed) < settings->games)
+    {
+        states.clear();
+        Agent first = agent.SetSeed(seed++);
+        Environment environment(first, agent.SetSeed(seed++), true);
+        environment.SetVerbose(false);
+        environment.SetObserver([&](const uint8_t* position, bool)
+        {
+            if (!PlayerEmpty(position) && !ComputerEmpty(position))
+                states.insert(states.end(), position, position + POSITION_SIZE);
+        });
+        /* Result is from the view of agent 1 which plays "Player" */
+        float target = (float)-environment.start();
+
+        size_t count = states.size() / POSITION_SIZE;
+        values.resize(count);
+        for (size_t t = 0; t < count; t++)
+        {
+            const uint8_t* state = &states[t * POSITION_SIZE];
+            values[t] = Evaluation(state) + network->SharedValue(state);
+        }
+
+        double gameLoss = 0.0;
+        for (size_t t = count; t-- > 0;)
+        {
+            float error = target - values[t];
+            gameLoss += error * error;
+            network->Update(&states[t * POSITION_SIZE], settings->learningRate * error);
+            /* lambda-return of the previous state */
+            target = (1.0f - settings->lambda) * values[t] + settings->lambda * target;
+        }
+        samples->fetch_add(count, std::memory_order_relaxed);
+        loss->fetch_add(gameLoss, std::memory_order_relaxed);
+    }
+}
+
+/* Train the weights in "path", which are created if the file doesn't exist yet */
+void tdTrain(const std::string& path, const TdSettings& settings)
+{
+    std::shared_ptr<NTupleNetwork> network = std::make_shared<NTupleNetwork>();
+    if (network->Load(path))
+        std::cout << "Continuing from " << path << std::endl;
+
+    std::atomic<uint64_t> games{ 0 }, samples{ 0 };
+    std::atomic<double> loss{ 0.0 };
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < settings.threads; i++)
+        workers.emplace_back(tdWorker, network.get(), network, &settings, &games, &samples, &loss, 0x9E3779B9u * (i + 1));
+
+    /* Report and checkpoint until all games are played */
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now(), last = begin;
+    uint64_t lastGames = 0, nextCheckpoint = settings.checkpoint;
+    while (true)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        uint64_t played = std::min(games.load(), settings.games);
+        bool finished = played >= settings.games;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - last >= std::chrono::seconds(1) || finished)
+        {
+            uint64_t positions = samples.exchange(0);
+            double error = loss.exchange(0.0);
+            std::cout << "Games " << played << ": " << (uint64_t)((played - lastGames) / std::chrono::duration<double>(now - last).count())
+                << " games/s, loss " << (positions > 0 ? error / positions : 0.0) << std::endl;
+            last = now;
+            lastGames = played;
+        }
+        if (finished)
+            break;
+        if (settings.checkpoint != 0 && played >= nextCheckpoint)
+        {
+            network->Save(path + ".tmp");
+            fs::rename(path + ".tmp", path);
+            nextCheckpoint += settings.checkpoint;
+        }
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+    network->Save(path + ".tmp");
+    fs::rename(path + ".tmp", path);
+    std::cout << "Trained " << settings.games << " games in "
+        << std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() << "s" << std::endl;
+}
+
+/*
+    Position records
+    Labeled positions are stored as fixed size 16 byte records so files can be memory mapped and read in place.
+    The first record of a file is a header carrying RECORD_MAGIC and the format version.
+*/
+#define RECORD_MAGIC 0x4345524D
+#define RECORD_VERSION 1
+#define RECORD_SOLVED 255
+
+struct PositionRecord
+{
+    /* Fields 0 - 5 and 7 - 12 with 6 bits each */
+    uint8_t pits[9];
+    uint8_t playerScore;
+    uint8_t computerScore;
+    /* 1 if "Player" is to move */
+    uint8_t player;
+    /* Computer positive */
+    int8_t score;
+    uint8_t bestMove;
+    /* Search depth of the label, RECORD_SOLVED for exact game values */
+    uint8_t depth;
+    uint8_t reserved;
+};
+static_assert(sizeof(PositionRecord) == 16, "Records have to stay 16 bytes");
+
+/* Returns false if a field holds more stones than 6 bits can store */
+bool packRecord(const uint8_t* position, bool player, int8_t score, uint8_t bestMove, uint8_t depth, PositionRecord& record)
+{
+    memset(&record, 0, sizeof(record));
+    for (int i = 0, bit = 0; i < 13; i++)
+    {
+        if (i == PLAYER_SCORE)
+            continue;
+        if (position[i] > 63)
+            return false;
+        for (int b = 0; b < 6; b++, bit++)
+            record.pits[bit / 8] |= ((position[i] >> b) & 1) << (bit % 8);
+    }
+    record.playerScore = position[PLAYER_SCORE];
+    record.computerScore = position[COMPUTER_SCORE];
+    record.player = player;
+    record.score = score;
+    record.bestMove = bestMove;
+    record.depth = depth;
+    return true;
+}
+
+/* Unpacks into a POSITION_SIZE board, returns the side to move */
+bool unpackRecord(const PositionRecord& record, uint8_t* position)
+{
+    memset(position, 0, POSITION_SIZE);
+    for (int i = 0, bit = 0; i < 13; i++)
+    {
+        if (i == PLAYER_SCORE)
+            continue;
+        for (int b = 0; b < 6; b++, bit++)
+            position[i] |= ((record.pits[bit / 8] >> (bit % 8)) & 1) << b;
+    }
+    position[PLAYER_SCORE] = record.playerScore;
+    position[COMPUTER_SCORE] = record.computerScore;
+    return record.player != 0;
+}
+
+PositionRecord recordHeader()
+{
+    PositionRecord header;
+    memset(&header, 0, sizeof(header));
+    uint32_t magic = RECORD_MAGIC;
+    memcpy(header.pits, &magic, 4);
+    header.pits[4] = RECORD_VERSION;
+    header.pits[5] = sizeof(PositionRecord);
+    return header;
+}
+
+/* Read only memory mapping of a whole file */
+class MappedFile
+{
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER length;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &length) || length.QuadPart == 0)
+            return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+            return;
+        data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        size = data != nullptr ? (size_t)length.QuadPart : 0;
+#else
+        int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return;
+        struct stat status;
+        if (fstat(descriptor, &status) == 0 && status.st_size > 0)
+        {
+            void* memory = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (memory != MAP_FAILED)
+            {
+                madvise(memory, status.st_size, MADV_SEQUENTIAL);
+                data = (const uint8_t*)memory;
+                size = status.st_size;
+            }
+        }
+        close(descriptor);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (data != nullptr)
+            UnmapViewOfFile(data);
+        if (mapping != nullptr)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (data != nullptr)
+            munmap((void*)data, size);
+#endif
+    }
+
+    const uint8_t* Data() const { return data; }
+    size_t Size() const { return size; }
+};
+
+/* Records of a mapped record file, empty if the header doesn't match */
+struct RecordView
+{
+    const PositionRecord* records = nullptr;
+    size_t count = 0;
+
+    explicit RecordView(const MappedFile& file)
+    {
+        PositionRecord header = recordHeader();
+        if (file.Size() < sizeof(PositionRecord) || memcmp(file.Data(), &header, sizeof(header)) != 0)
+            return;
+        records = (const PositionRecord*)file.Data() + 1;
+        count = file.Size() / sizeof(PositionRecord) - 1;
+    }
+};
+
+/* Score and best move of "position" from a full window search of every root move, Computer positive */
+uint8_t labelPosition(const uint8_t* position, bool player, uint8_t depth, const SearchSettings& settings, int8_t& score,
+    SearchContext& context)
+{
+    uint8_t bestMove = 0;
+    score = player ? 127 : -128;
+    for (int i = player ? 0 : 7, end = i + 6; i < end; i++)
+    {
+        if (position[i] == 0)
+            continue;
+        uint8_t PositionCopy[POSITION_SIZE];
+        memcpy(PositionCopy, position, POSITION_LENGTH);
+        uint8_t kind = moveKind(PositionCopy, i, player);
+        bool next = move(PositionCopy, i, player);
+        int8_t result = minimax(PositionCopy, next, settings.ChildDepth(depth * settings.DepthUnit(), kind), -128, 127, settings, context);
+        if (player ? result < score : result > score)
+        {
+            score = result;
+            bestMove = i;
+        }
+    }
+    return bestMove;
+}
+
+uint8_t labelPosition(const uint8_t* position, bool player, uint8_t depth, const SearchSettings& settings, int8_t& score)
+{
+    SearchContext context;
+    return labelPosition(position, player, depth, settings, score, context);
+}
+
+/*
+    Game value of "position": table searches one ply deeper each time until one reaches no horizon leaf.
+    Returns false once "nodeBudget" nodes were searched without that, the position is then left unlabeled.
+*/
+bool solvePosition(const uint8_t* position, bool player, TranspositionTable& table, uint64_t nodeBudget, int8_t& score, uint8_t& bestMove)
+{
+    SearchSettings settings;
+    settings.table = &table;
+    uint64_t nodes = 0;
+    for (uint8_t depth = 1; depth < TT_SOLVED && nodes < nodeBudget; depth++)
+    {
+        SearchContext context;
+        bestMove = labelPosition(position, player, depth, settings, score, context);
+        if (context.horizon == 0)
+            return true;
+        nodes += context.stats.nodes;
+    }
+    return false;
+}
+
+/*
+    Training data generation
+    Producer threads play greedy self-play games through the "Environment" loop, starting from the start position
+    or from "RandomizePosition", sample positions out of them and label each with a search of every root move.
+    Records go through a bounded queue to one writer which fills shards of DATA_SHARD_RECORDS records:
+        <dir>/shard_00000.rec, <dir>/shard_00001.rec, ...
+    A stopped run continues where it ended: existing shards are counted, a partially written record at the end
+    is cut off and the last shard is appended to.
+*/
+#define DATA_SHARD_RECORDS (1 << 20)
+#define DATA_QUEUE_CAPACITY 4096
+/* Transposition table of each producer thread when solving, kept from one position to the next */
+#define DATA_SOLVE_MEGABYTES 64
+
+template<typename T>
+class BoundedQueue
+{
+private:
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+
+public:
+    explicit BoundedQueue(size_t capacity)
+        : capacity(capacity)
+    {}
+
+    /* Blocks while the queue is full, returns false once the queue is closed */
+    bool Push(const T& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [&]() { return items.size() < capacity || closed; });
+        if (closed)
+            return false;
+        items.push_back(item);
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /* Blocks while the queue is empty, returns false once it is closed and drained */
+    bool Pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [&]() { return !items.empty() || closed; });
+        if (items.empty())
+            return false;
+        item = items.front();
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+};
+
+struct DataSettings
+{
+    uint64_t records = 1000000;
+    /* Label search depth, 0 solves every position that "solvePosition" finishes within "solveNodes" */
+    uint8_t depth = 12;
+    uint64_t solveNodes = 1 << 22;
+    /* Share of games starting from "RandomizePosition" instead of the start position */
+    double randomShare = 0.5;
+    /* Chance of a self-play position being labeled */
+    double sampleRate = 0.125;
+    /* Random moves of the self-play agents */
+    double exploration = 0.2;
+    /* Self-play evaluation, store difference if nullptr */
+    std::shared_ptr<const NTupleNetwork> network;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+std::string shardName(uint32_t shard)
+{
+    std::string number = std::to_string(shard);
+    return "shard_" + std::string(number.size() < 5 ? 5 - number.size() : 0, '0') + number + ".rec";
+}
+
+void dataProducer(const DataSettings* settings, BoundedQueue<PositionRecord>* queue, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    Agent agent("greedy");
+    agent.SetNetwork(settings->network).SetExploration(settings->exploration);
+    std::unique_ptr<TranspositionTable> table;
+    if (settings->depth == 0)
+        table = std::make_unique<TranspositionTable>(DATA_SOLVE_MEGABYTES);
+    std::vector<uint8_t> samples;
+    bool running = true;
+
+    while (running)
+    {
+        samples.clear();
+        Agent first = agent.SetSeed(rng());
+        Environment environment(first, agent.SetSeed(rng()), rng() % 2 == 0);
+        environment.SetVerbose(false);
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < settings->randomShare)
+            environment.RandomizePosition((uint8_t)(6 + rng() % 43), rng());
+        environment.SetObserver([&](const uint8_t* position, bool player)
+        {
+            if (PlayerEmpty(position) || ComputerEmpty(position) || std::uniform_real_distribution<double>(0.0, 1.0)(rng) >= settings->sampleRate)
+                return;
+            samples.insert(samples.end(), position, position + POSITION_SIZE);
+            samples.push_back(player);
+        });
+        environment.start();
+
+        for (size_t offset = 0; offset < samples.size() && running; offset += POSITION_SIZE + 1)
+        {
+            const uint8_t* position = &samples[offset];
+            bool player = samples[offset + POSITION_SIZE] != 0;
+            int8_t score;
+            uint8_t bestMove;
+            if (table != nullptr)
+            {
+                if (!solvePosition(position, player, *table, settings->solveNodes, score, bestMove))
+                    continue;
+            }
+            else
+                bestMove = labelPosition(position, player, settings->depth, SearchSettings(), score);
+            PositionRecord record;
+            if (packRecord(position, player, score, bestMove, table != nullptr ? RECORD_SOLVED : settings->depth, record))
+                running = queue->Push(record);
+        }
+    }
+}
+
+void generateData(const fs::path& dir, const DataSettings& settings)
+{
+    fs::create_directories(dir);
+
+    /* Count what previous runs wrote, cutting off partial records */
+    uint64_t written = 0;
+    uint32_t shard = 0;
+    uint64_t inShard = 0;
+    while (fs::exists(dir / shardName(shard)))
+    {
+        fs::path path = dir / shardName(shard);
+        uint64_t records = fs::file_size(path) / sizeof(PositionRecord);
+        if (records * sizeof(PositionRecord) != fs::file_size(path))
+            fs::resize_file(path, records * sizeof(PositionRecord));
+        inShard = records > 0 ? records - 1 : 0;
+        written += inShard;
+        if (inShard < DATA_SHARD_RECORDS)
+            break;
+        /* A full shard is continued by a fresh one at the next index */
+        shard++;
+        inShard = 0;
+    }
+    if (written >= settings.records)
+    {
+        std::cout << dir << " already holds " << written << " records" << std::endl;
+        return;
+    }
+    if (written > 0)
+        std::cout << "Continuing after " << written << " records" << std::endl;
+
+    BoundedQueue<PositionRecord> queue(DATA_QUEUE_CAPACITY);
+    std::vector<std::thread> producers;
+    uint32_t seed = std::random_device{}();
+    for (unsigned i = 0; i < settings.threads; i++)
+        producers.emplace_back(dataProducer, &settings, &queue, seed + i * 0x9E3779B9u);
+
+    std::ofstream file;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now(), last = begin;
+    uint64_t started = written;
+    PositionRecord record;
+    while (written < settings.records && queue.Pop(record))
+    {
+        if (!file.is_open() || inShard == DATA_SHARD_RECORDS)
+        {
+            if (inShard == DATA_SHARD_RECORDS)
+            {
+                shard++;
+                inShard = 0;
+            }
+            file.close();
+            fs::path path = dir / shardName(shard);
+            bool fresh = !fs::exists(path) || fs::file_size(path) == 0;
+            file.open(path, std::ios::binary | std::ios::app);
+            if (fresh)
+            {
+                PositionRecord header = recordHeader();
+                file.write((const char*)&header, sizeof(header));
+            }
+        }
+        file.write((const char*)&record, sizeof(record));
+        written++;
+        inShard++;
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - last >= std::chrono::seconds(1))
+        {
+            file.flush();
+            std::cout << "\rRecords " << written << "/" << settings.records << ", "
+                << (uint64_t)((written - started) / std::chrono::duration<double>(now - begin).count()) << " records/s" << std::flush;
+            last = now;
+        }
+    }
+    queue.Close();
+    for (std::thread& producer : producers)
+        producer.join();
+    file.close();
+    std::cout << "\rRecords " << written << "/" << settings.records << " in " << shard + 1 << " shards" << std::endl;
+}
+
+/*
+    Texel tuning
+    Fits the linear evaluation to the record scores by minimizing the mean squared difference of
+    sigmoid(evaluation / K) and sigmoid(score / K), which keeps lopsided positions from dominating the fit.
+    Both sides are squashed, so K can't be fitted like with game results, it is fixed at TEXEL_SCALE stones.
+    Every epoch the threads compute the gradient over their part of the mapped records, which are summed up
+    for one Adam step.
+*/
+#define TEXEL_SCALE 8.0
+
+double texelError(const std::vector<RecordView>& data, size_t count, const float* weights, double scale, double* gradient, unsigned threads)
+{
+    std::vector<std::thread> workers;
+    std::vector<double> errors(threads, 0.0);
+    std::vector<double> gradients(threads * LINEAR_FEATURES, 0.0);
+    for (unsigned t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]()
+        {
+            double* local = &gradients[t * LINEAR_FEATURES];
+            for (const RecordView& view : data)
+            for (size_t r = view.count * t / threads, end = view.count * (t + 1) / threads; r < end; r++)
+            {
+                uint8_t position[POSITION_SIZE];
+                bool player = unpackRecord(view.records[r], position);
+                float features[LINEAR_FEATURES];
+                LinearEvaluation::Features(position, player, features);
+                double value = 0.0;
+                for (int i = 0; i < LINEAR_FEATURES; i++)
+                    value += weights[i] * features[i];
+                double predicted = 1.0 / (1.0 + std::exp(-value / scale));
+                double target = 1.0 / (1.0 + std::exp(-view.records[r].score / scale));
+                double difference = predicted - target;
+                errors[t] += difference * difference;
+                /* d/dw (sigmoid(v / K) - target)^2 */
+                double slope = 2.0 * difference * predicted * (1.0 - predicted) / scale;
+                for (int i = 0; i < LINEAR_FEATURES; i++)
+                    local[i] += slope * features[i];
+            }
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+
+    double error = 0.0;
+    for (unsigned t = 0; t < threads; t++)
+        error += errors[t];
+    if (gradient != nullptr)
+    {
+        for (int i = 0; i < LINEAR_FEATURES; i++)
+        {
+            gradient[i] = 0.0;
+            for (unsigned t = 0; t < threads; t++)
+                gradient[i] += gradients[t * LINEAR_FEATURES + i] / count;
+        }
+    }
+    return error / count;
+}
+
+void texelTune(const std::string& dataPath, const std::string& weightsPath, int epochs, double rate)
+{
+    /* A single record file or a directory of shards */
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<RecordView> data;
+    size_t count = 0;
+    std::vector<std::string> paths;
+    if (fs::is_directory(dataPath))
+    {
+        for (const fs::directory_entry& entry : fs::directory_iterator(dataPath))
+            if (entry.path().extension() == ".rec")
+                paths.push_back(entry.path().string());
+    }
+    else
+        paths.push_back(dataPath);
+    for (const std::string& path : paths)
+    {
+        files.push_back(std::make_unique<MappedFile>(path));
+        data.emplace_back(*files.back());
+        count += data.back().count;
+    }
+    if (count == 0)
+    {
+        std::cout << "No records in " << dataPath << std::endl;
+        return;
+    }
+    LinearEvaluation evaluation;
+    if (evaluation.Load(weightsPath))
+        std::cout << "Continuing from " << weightsPath << std::endl;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    double scale = TEXEL_SCALE;
+    std::cout << count << " records, initial error " << texelError(data, count, evaluation.weights, scale, nullptr, threads) << std::endl;
+
+    double first[LINEAR_FEATURES] = {}, second[LINEAR_FEATURES] = {}, gradient[LINEAR_FEATURES];
+    for (int epoch = 1; epoch <= epochs; epoch++)
+    {
+        double error = texelError(data, count, evaluation.weights, scale, gradient, threads);
+        for (int i = 0; i < LINEAR_FEATURES; i++)
+        {
+            first[i] = 0.9 * first[i] + 0.1 * gradient[i];
+            second[i] = 0.999 * second[i] + 0.001 * gradient[i] * gradient[i];
+            double corrected = first[i] / (1.0 - std::pow(0.9, epoch));
+            double variance = second[i] / (1.0 - std::pow(0.999, epoch));
+            evaluation.weights[i] -= (float)(rate * corrected / (std::sqrt(variance) + 1e-9));
+        }
+        if (epoch % 50 == 0 || epoch == epochs)
+            std::cout << "Epoch " << epoch << ": error " << error << std::endl;
+    }
+    for (int i = 0; i < LINEAR_FEATURES; i++)
+        std::cout << LinearEvaluation::Names[i] << " " << evaluation.weights[i] << std::endl;
+    evaluation.Save(weightsPath);
+}
+
+/*
+    Depth calibration
+    Collects up to "samples" positions for every (stone bucket, legal moves) pair from greedy self-play games,
+    then deepens the search of every pair until its slowest position no longer finishes within "target" seconds.
+    The slowest sample has to stay CALIBRATION_MARGIN times below the target, positions of the same phase
+    that were not sampled can take a lot longer.
+    Pairs without positions take the depth of the closest calibrated bucket with the same amount of moves.
+*/
+#define CALIBRATION_MARGIN 3.0
+
+void calibrateDepth(const std::string& path, double target, int samples, uint8_t maxDepth)
+{
+    std::vector<uint8_t> positions[SCHEDULE_BUCKETS][7];
+    std::mt19937 rng(7);
+    Agent agent("greedy");
+    agent.SetExploration(0.3);
+    for (int game = 0; game < 20000; game++)
+    {
+        Agent first = agent.SetSeed(rng());
+        Environment environment(first, agent.SetSeed(rng()), rng() % 2 == 0);
+        environment.SetVerbose(false);
+        if (game % 2 == 1)
+            environment.RandomizePosition((uint8_t)(6 + rng() % 19), rng());
+        environment.SetObserver([&](const uint8_t* position, bool player)
+        {
+            if (PlayerEmpty(position) || ComputerEmpty(position))
+                return;
+            std::vector<uint8_t>& group = positions[DepthSchedule::Bucket(position)][DepthSchedule::LegalMoves(position, player)];
+            if ((int)group.size() < samples * (POSITION_SIZE + 1))
+            {
+                group.insert(group.end(), position, position + POSITION_SIZE);
+                group.push_back(player);
+            }
+        });
+        environment.start();
+    }
+
+    DepthSchedule schedule;
+    for (int bucket = 0; bucket < SCHEDULE_BUCKETS; bucket++)
+    {
+        for (int moves = 1; moves <= 6; moves++)
+        {
+            std::vector<uint8_t>& group = positions[bucket][moves];
+            if (group.empty())
+                continue;
+            uint8_t depth = 1;
+            double slowest = 0.0;
+            while (depth < maxDepth)
+            {
+                /* Each deeper search costs a multiple of the last one, stop before it would exceed the target */
+                double worst = 0.0;
+                for (size_t offset = 0; offset < group.size(); offset += POSITION_SIZE + 1)
+                {
+                    uint8_t position[POSITION_SIZE];
+                    memcpy(position, &group[offset], POSITION_SIZE);
+                    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+                    minimaxRoot(position, group[offset + POSITION_SIZE] != 0, depth + 1);
+                    worst = std::max(worst, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+                    if (worst * CALIBRATION_MARGIN > target)
+                        break;
+                }
+                if (worst * CALIBRATION_MARGIN > target)
+                    break;
+                depth++;
+                slowest = worst;
+            }
+            schedule.depths[bucket][moves] = depth;
+            std::cout << "Stones " << bucket * SCHEDULE_BUCKET << "-" << bucket * SCHEDULE_BUCKET + SCHEDULE_BUCKET - 1
+                << ", " << moves << " moves: depth " << +depth << " (" << slowest * 1000.0 << "ms)" << std::endl;
+        }
+    }
+
+    for (int moves = 1; moves <= 6; moves++)
+    {
+        for (int bucket = 0; bucket < SCHEDULE_BUCKETS; bucket++)
+        {
+            if (schedule.depths[bucket][moves] != 0)
+                continue;
+            for (int distance = 1; distance < SCHEDULE_BUCKETS; distance++)
+            {
+                /* Prefer the denser neighbour, its depth is the safer one */
+                if (bucket + distance < SCHEDULE_BUCKETS && positions[bucket + distance][moves].size() > 0)
+                {
+                    schedule.depths[bucket][moves] = schedule.depths[bucket + distance][moves];
+                    break;
+                }
+                if (bucket - distance >= 0 && positions[bucket - distance][moves].size() > 0)
+                {
+                    schedule.depths[bucket][moves] = schedule.depths[bucket - distance][moves];
+                    break;
+                }
+            }
+        }
+    }
+    schedule.Save(path);
+}
+
+/* Deepening search of "position" that reports the best "lines" root moves with exact scores after every iteration */
+void analyzePosition(uint8_t* position, bool player, uint8_t depth, uint8_t lines, size_t megabytes)
+{
+    TranspositionTable table(megabytes);
+    SearchSettings settings;
+    settings.table = &table;
+    settings.multiPv = lines;
+    print(position);
+    SearchResult result;
+    uint64_t nodes = 0;
+    for (uint8_t iteration = 1; iteration <= depth; iteration++)
+    {
+        result = minimaxRoot(position, player, iteration, settings, &result);
+        nodes += result.nodes;
+        std::cout << "Depth " << +iteration << ": move " << (player ? result.bestMove : 12 - result.bestMove) << ", evaluation "
+            << (player ? -result.score : +result.score) << " (" << result.nodes << " nodes)" << std::endl;
+    }
+    printSearch(result, position, player, lines > 0 ? lines : 6);
+    std::cout << nodes << " nodes over all iterations" << std::endl;
+}
+
+/*
+    Search benchmarks
+    Positions are sampled from greedy self-play games with random moves, a seed always gives the same set.
+*/
+/*
+    "count" positions of POSITION_SIZE bytes followed by the side to move, with at least "minStones" stones in the fields.
+    Sparse endgames are solved within milliseconds and would only measure the deepening loop.
+*/
+std::vector<uint8_t> samplePositions(int count, uint32_t seed, int minStones = 28)
+{
+    std::vector<uint8_t> positions;
+    std::mt19937 rng(seed);
+    Agent agent("greedy");
+    agent.SetExploration(0.3);
+    while ((int)positions.size() < count * (POSITION_SIZE + 1))
+    {
+        Agent first = agent.SetSeed(rng());
+        Environment environment(first, agent.SetSeed(rng()), rng() % 2 == 0);
+        environment.SetVerbose(false);
+        environment.SetObserver([&](const uint8_t* position, bool player)
+        {
+            if (PlayerEmpty(position) || ComputerEmpty(position) || rng() % 4 != 0 || (int)positions.size() >= count * (POSITION_SIZE + 1))
+                return;
+            int stones = 0;
+            for (int i = 0; i < 6; i++)
+                stones += position[i] + position[i + 7];
+            if (stones < minStones)
+                return;
+            positions.insert(positions.end(), position, position + POSITION_SIZE);
+            positions.push_back(player);
+        });
+        environment.start();
+    }
+    return positions;
+}
+
+/* Sums of "benchSearches" over all positions */
+struct BenchTotals
+{
+    SearchStats stats;
+    double seconds = 0.0;
+    /* Last completed search of every position */
+    std::vector<SearchResult> results;
+
+    /* Per position averages */
+    uint64_t Nodes() const { return stats.nodes / std::max<size_t>(results.size(), 1); }
+    double Milliseconds() const { return seconds * 1000.0 / std::max<size_t>(results.size(), 1); }
+};
+
+/*
+    Searches every position of "samplePositions" with default settings changed by "configure", which a 64 MB table
+    is set in first. The table is cleared before each position, or only aged with "age" like a game does between moves.
+    The search deepens to "depth" like the agents and ends at a decided result like them, "deepen" off searches "depth" once.
+    With "limit" > 0 seconds each position deepens until the time is up instead, the stopped iteration is dropped.
+*/
+BenchTotals benchSearches(const std::vector<uint8_t>& positions, uint8_t depth, const std::function<void(SearchSettings&)>& configure,
+    bool deepen = true, bool age = false, double limit = 0.0)
+{
+    TranspositionTable table(64);
+    SearchSettings settings;
+    settings.table = &table;
+    configure(settings);
+    std::atomic<bool> stop{ false };
+    if (limit > 0.0)
+        settings.stop = &stop;
+
+    BenchTotals totals;
+    for (size_t offset = 0; offset < positions.size(); offset += POSITION_SIZE + 1)
+    {
+        uint8_t position[POSITION_SIZE];
+        memcpy(position, &positions[offset], POSITION_SIZE);
+        bool player = positions[offset + POSITION_SIZE] != 0;
+        if (settings.table != nullptr)
+        {
+            if (age)
+                settings.table->Age();
+            else
+                settings.table->Clear();
+        }
+        stop = false;
+        std::unique_ptr<StopTimer> timer;
+        if (limit > 0.0)
+            timer = std::make_unique<StopTimer>(stop, limit);
+        SearchResult result;
+        int last = limit > 0.0 ? MAX_PLY - 1 : depth;
+        /* Deeper iterations cannot change a proven result, the agents stop deepening as well */
+        for (int iteration = deepen ? 1 : last; iteration <= last && !(settings.earlyStop && result.decided); iteration++)
+        {
+            SearchResult next = minimaxRoot(position, player, (uint8_t)iteration, settings, &result);
+            totals.stats += next.stats;
+            totals.seconds += next.seconds;
+            if (next.depth == 0)
+                break;
+            result = next;
+        }
+        totals.results.push_back(result);
+    }
+    return totals;
+}
+
+/* Depth reached with and without late move reductions at "milliseconds" per position, then a timed match between both */
+void lmrBench(double milliseconds, int count, int openings, uint8_t moves, uint8_t reduction)
+{
+    std::vector<uint8_t> positions = samplePositions(count, 11);
+    for (int reduced = 0; reduced < 2; reduced++)
+    {
+        BenchTotals totals = benchSearches(positions, 0, [&](SearchSettings& settings)
+        {
+            settings.lmrMoves = reduced ? moves : 0;
+            settings.lmrReduction = reduction;
+        }, true, false, milliseconds / 1000.0);
+        double depth = 0.0;
+        for (const SearchResult& result : totals.results)
+            depth += result.depth;
+        if (reduced)
+            std::cout << "Reductions after " << +moves << " moves by " << +reduction << ": ";
+        else
+            std::cout << "Without reductions: ";
+        std::cout << "depth " << depth / count << ", " << totals.Nodes() << " nodes" << std::endl;
+    }
+
+    if (openings <= 0)
+        return;
+    /* A game clock worth about 20 moves of the benchmark time */
+    Agent withReductions("timed");
+    withReductions.SetHash(64).SetReductions(moves, reduction);
+    Agent withoutReductions("timed");
+    withoutReductions.SetHash(64);
+    selfPlayMatch(withReductions, withoutReductions, openings, 1, milliseconds * 0.02, milliseconds * 0.0005);
+}
+
+/*
+    Every pair of depth semantics plays a match in which each move deepens until "nodes" nodes are searched,
+    so the results compare strength per node and the move times strength per CPU second
+*/
+void depthModeMatch(uint64_t nodes, int openings, uint8_t extraCost, uint8_t captureCost)
+{
+    Agent agents[3] = { Agent("computer"), Agent("computer"), Agent("computer") };
+    for (int mode = 0; mode < 3; mode++)
+        agents[mode].SetHash(64).SetNodeBudget(nodes).SetDepthMode((uint8_t)mode, extraCost, captureCost);
+    selfPlayMatch(agents[DEPTH_TURNS], agents[DEPTH_PLIES], openings, 1);
+    selfPlayMatch(agents[DEPTH_FRACTIONAL], agents[DEPTH_PLIES], openings, 1);
+    selfPlayMatch(agents[DEPTH_FRACTIONAL], agents[DEPTH_TURNS], openings, 1);
+}
+
+/*
+    Accuracy against the cost of quiescence: every depth up to "reference" - 1 is searched with and without it and
+    compared with a "reference" deep search of the same positions, by best move agreement and score error
+*/
+void quiescenceBench(int count, uint8_t reference, uint8_t plies)
+{
+    std::vector<uint8_t> positions = samplePositions(count, 13);
+    /* Every iteration to the end, a decided result would stop short of the reference depth */
+    std::vector<SearchResult> expected = benchSearches(positions, reference, [](SearchSettings& settings) { settings.earlyStop = false; }).results;
+
+    for (uint8_t depth = 1; depth < reference; depth++)
+    {
+        for (int withQuiescence = 0; withQuiescence < 2; withQuiescence++)
+        {
+            BenchTotals totals = benchSearches(positions, depth, [&](SearchSettings& settings)
+            {
+                settings.table = nullptr;
+                settings.quiescence = withQuiescence ? plies : 0;
+            }, false);
+            int agree = 0;
+            double error = 0.0;
+            for (size_t index = 0; index < expected.size(); index++)
+            {
+                agree += totals.results[index].bestMove == expected[index].bestMove;
+                error += std::abs(totals.results[index].score - expected[index].score);
+            }
+            std::ostringstream line;
+            line << "Depth " << std::setw(2) << +depth << (withQuiescence ? " quiescence: " : "            : ")
+                << std::setw(10) << totals.Nodes() << " nodes, " << std::setw(5) << std::setprecision(3) << 100.0 * agree / count
+                << "% best moves, score error " << error / count;
+            std::cout << line.str() << std::endl;
+        }
+    }
+}
+
+/* Nodes of fixed depth searches with and without killer and counter moves, each with and without the table */
+void orderingBench(int count, uint8_t depth)
+{
+    std::vector<uint8_t> positions = samplePositions(count, 17);
+    for (int withTable = 0; withTable < 2; withTable++)
+    {
+        for (int withKillers = 0; withKillers < 2; withKillers++)
+        {
+            BenchTotals totals = benchSearches(positions, depth, [&](SearchSettings& settings)
+            {
+                settings.killers = withKillers != 0;
+                if (!withTable)
+                    settings.table = nullptr;
+            }, false);
+            std::cout << (withTable ? "Table, " : "No table, ") << (withKillers ? "killers: " : "no killers: ") << totals.Nodes()
+                << " nodes, " << totals.Milliseconds() << "ms per position" << std::endl;
+        }
+    }
+}
+
+/* Nodes, time and cutoff counters of table searches to "depth" with and without enhanced transposition cutoffs */
+void etcBench(int count, uint8_t depth)
+{
+    std::vector<uint8_t> positions = samplePositions(count, 19);
+    for (int withEtc = 0; withEtc < 2; withEtc++)
+    {
+        /* Deepening fills the table the way a game search does */
+        BenchTotals totals = benchSearches(positions, depth, [&](SearchSettings& settings) { settings.etc = withEtc != 0; });
+        std::cout << (withEtc ? "ETC:    " : "No ETC: ") << totals.Nodes() << " nodes, " << totals.Milliseconds() << "ms per position";
+        if (withEtc)
+            std::cout << ", " << totals.stats.etcCutoffs << " cutoffs in " << totals.stats.etcProbes << " probes";
+        std::cout << std::endl;
+    }
+}
+
+/*
+    Repeats deepening table searches to "depth" of sampled positions "runs" times in deterministic mode and checks that
+    every run finds the same moves, scores and node counts, then compares the time against the shared table search
+*/
+void determinismCheck(int count, uint8_t depth, int runs)
+{
+    std::vector<uint8_t> positions = samplePositions(count, 29);
+    DeltaTables deltas;
+    for (int deterministic = 1; deterministic >= 0; deterministic--)
+    {
+        std::vector<SearchResult> reference;
+        int mismatches = 0;
+        uint64_t nodes = 0;
+        double seconds = 0.0;
+        for (int run = 0; run < runs; run++)
+        {
+            BenchTotals totals = benchSearches(positions, depth, [&](SearchSettings& settings)
+            {
+                settings.deterministic = deterministic != 0;
+                settings.deltas = &deltas;
+            });
+            nodes += totals.stats.nodes;
+            seconds += totals.seconds;
+            if (run == 0)
+            {
+                reference = totals.results;
+                continue;
+            }
+            for (size_t index = 0; index < reference.size(); index++)
+            {
+                const SearchResult& result = totals.results[index];
+                if (result.bestMove != reference[index].bestMove || result.nodes != reference[index].nodes
+                    || memcmp(result.scores, reference[index].scores, sizeof(result.scores)) != 0)
+                    mismatches++;
+            }
+        }
+        std::cout << (deterministic ? "Deterministic: " : "Shared table:  ") << mismatches << " of " << (runs - 1) * count
+            << " repeated searches differ, " << nodes / ((uint64_t)runs * count) << " nodes, " << seconds * 1000.0 / ((double)runs * count)
+            << "ms per position" << std::endl;
+    }
+}
+
+/*
+    Deepening table searches to "depth" on "threads" threads with and without root load balancing: time, nodes, the
+    share of the biggest root move in the nodes of the last iteration and the root scores that differ between the two
+*/
+void balanceBench(int count, uint8_t depth, unsigned threads)
+{
+    std::vector<uint8_t> positions = samplePositions(count, 31);
+    std::vector<SearchResult> unbalanced;
+    for (int balance = 0; balance < 2; balance++)
+    {
+        /* Both runs search every iteration in full so that their root scores can be compared */
+        BenchTotals totals = benchSearches(positions, depth, [&](SearchSettings& settings)
+        {
+            settings.threads = threads;
+            settings.balance = balance != 0;
+            settings.earlyStop = false;
+        });
+        double biggest = 0.0;
+        int differ = 0;
+        for (size_t index = 0; index < totals.results.size(); index++)
+        {
+            const SearchResult& result = totals.results[index];
+            biggest += (double)*std::max_element(result.moveNodes, result.moveNodes + 6) / std::max<uint64_t>(result.nodes, 1);
+            if (balance)
+                differ += memcmp(result.scores, unbalanced[index].scores, sizeof(result.scores)) != 0;
+        }
+        if (!balance)
+            unbalanced = totals.results;
+        std::ostringstream share;
+        share << std::setprecision(3) << biggest * 100.0 / count;
+        std::cout << (balance ? "Balanced:   " : "Unbalanced: ") << totals.Nodes() << " nodes, " << totals.Milliseconds()
+            << "ms per position, biggest root move " << share.str() << "% of the nodes";
+        if (balance)
+            std::cout << ", root scores differ in " << differ << " of " << count << " positions";
+        std::cout << std::endl;
+    }
+}
+
+/*
+    Deepening table searches to "depth" of positions from all phases of the game with and without ending the search once
+    a root move is proven to win: nodes, time and the positions that were decided
+*/
+void earlyStopBench(int count, uint8_t depth)
+{
+    std::vector<uint8_t> positions = samplePositions(count, 37, 0);
+    for (int earlyStop = 0; earlyStop < 2; earlyStop++)
+    {
+        BenchTotals totals = benchSearches(positions, depth, [&](SearchSettings& settings) { settings.earlyStop = earlyStop != 0; });
+        int decided = 0;
+        for (const SearchResult& result : totals.results)
+            decided += result.decided;
+        std::cout << (earlyStop ? "Early stop: " : "Full search: ") << totals.Nodes() << " nodes, " << totals.Milliseconds()
+            << "ms per position, " << decided << " of " << count << " decided" << std::endl;
+    }
+}
+
+/*
+    Nodes per second of deepening searches to "depth" with a "megabytes" table on normal pages, on huge pages, with pinned
+    threads and, on NUMA systems, interleaved over the nodes. The page size the system granted is printed with each.
+*/
+void pagesBench(size_t megabytes, int count, uint8_t depth)
+{
+    std::vector<uint8_t> positions = samplePositions(count, 43);
+    const char* PageNames[4] = { "normal pages", "huge pages", "1 GB pages", "transparent huge pages" };
+    uint64_t nodes = numaNodes();
+    int configurations = (nodes & (nodes - 1)) != 0 ? 4 : 3;
+    double baseline = 0.0;
+    for (int configuration = 0; configuration < configurations; configuration++)
+    {
+        TranspositionTable table(megabytes, configuration == 0 ? TT_PAGES_DEFAULT : megabytes >= 4096 ? TT_PAGES_GIGANTIC : TT_PAGES_HUGE,
+            configuration == 3 ? TT_NUMA_INTERLEAVE : TT_NUMA_LOCAL);
+        BenchTotals totals = benchSearches(positions, depth, [&](SearchSettings& settings)
+        {
+            settings.table = &table;
+            settings.pinThreads = configuration >= 2;
+        });
+        double nps = totals.stats.nodes / std::max(totals.seconds, 1e-9);
+        if (configuration == 0)
+            baseline = nps;
+        std::ostringstream line;
+        line << std::left << std::setw(22) << PageNames[table.Pages()] << std::right << (configuration >= 2 ? ", pinned" : "        ")
+            << (configuration == 3 ? ", interleaved" : "             ") << ": " << (uint64_t)nps << " nodes/s ("
+            << std::showpos << std::setprecision(3) << (nps / baseline - 1.0) * 100.0 << "%)";
+        std::cout << line.str() << std::endl;
+    }
+}
+
+/*
+    Replacement policies of a "megabytes" table, small enough to be overwritten many times, in deepening searches
+    to "depth" that age the table between positions like a game does, and the "tiered" policy without prefetching
+*/
+void replacementBench(size_t megabytes, int count, uint8_t depth)
+{
+    std::vector<uint8_t> positions = samplePositions(count, 47);
+    const char* PolicyNames[4] = { "always", "depth", "aged", "tiered" };
+    for (int policy = TT_REPLACE_ALWAYS; policy <= TT_REPLACE_TIERED + 1; policy++)
+    {
+        TranspositionTable table(megabytes);
+        table.SetPolicy((uint8_t)std::min(policy, TT_REPLACE_TIERED));
+        bool prefetch = policy <= TT_REPLACE_TIERED;
+        BenchTotals totals = benchSearches(positions, depth, [&](SearchSettings& settings)
+        {
+            settings.table = &table;
+            settings.prefetch = prefetch;
+        }, true, true);
+        std::cout << std::left << std::setw(22) << PolicyNames[std::min(policy, TT_REPLACE_TIERED)] + std::string(prefetch ? ":" : ", no prefetch:")
+            << std::right << totals.Nodes() << " nodes, " << totals.Milliseconds()
+            << "ms, " << (uint64_t)(totals.stats.nodes / std::max(totals.seconds, 1e-9)) << " nodes/s" << std::endl;
+    }
+}
+
+/*
+    Fits the ProbCut model: the scores of every root move of sampled positions at "depth" against the scores
+    "reduction" plies shallower, least squares for "a" and "b", "sigma" is the standard deviation of the residuals
+*/
+void probCutCalibrate(const std::string& path, int count, uint8_t depth, uint8_t reduction)
+{
+    std::vector<uint8_t> positions = samplePositions(count, 23);
+    double n = 0.0, sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+    std::vector<std::pair<int, int>> pairs;
+    for (size_t offset = 0; offset < positions.size(); offset += POSITION_SIZE + 1)
+    {
+        bool player = positions[offset + POSITION_SIZE] != 0;
+        SearchResult shallow = minimaxRoot(&positions[offset], player, depth - reduction);
+        SearchResult deep = minimaxRoot(&positions[offset], player, depth);
+        for (int i = 0; i < 6; i++)
+        {
+            if (positions[offset + (player ? i : i + 7)] == 0)
+                continue;
+            int x = shallow.scores[i], y = deep.scores[i];
+            pairs.emplace_back(x, y);
+            n += 1.0;
+            sumX += x;
+            sumY += y;
+            sumXX += (double)x * x;
+            sumXY += (double)x * y;
+        }
+    }
+
+    ProbCutModel model;
+    model.reduction = reduction;
+    model.minDepth = reduction + 2;
+    double denominator = n * sumXX - sumX * sumX;
+    if (denominator > 0.0)
+    {
+        model.a = (float)((n * sumXY - sumX * sumY) / denominator);
+        model.b = (float)((sumY - model.a * sumX) / n);
+    }
+    double squares = 0.0;
+    for (const std::pair<int, int>& pair : pairs)
+    {
+        double residual = pair.second - (model.a * pair.first + model.b);
+        squares += residual * residual;
+    }
+    model.sigma = (float)std::sqrt(squares / std::max(1.0, n - 2.0));
+    std::cout << "deep = " << model.a << " * shallow + " << model.b << ", sigma " << model.sigma << " (" << pairs.size() << " moves)" << std::endl;
+    if (!model.Save(path))
+        std::cout << "[ERROR]: Could not write " << path << std::endl;
+}
+
+/*
+    Sequential probability ratio test of "agentA" against "agentB" in timed game pairs from random openings.
+    H0: agent A is "elo0" stronger, H1: it is "elo1" stronger, both with 5% error. The log likelihood ratio uses the
+    normal approximation of the game scores and is checked after every pair, the test stops at "maxGames" if undecided.
+    Returns 1 if H1 is accepted, -1 for H0 and 0 if undecided.
+*/
+int sprtMatch(const Agent& agentA, const Agent& agentB, double elo0, double elo1, int maxGames, uint32_t seed, double clock, double increment)
+{
+    const double errorRate = 0.05;
+    double lower = std::log(errorRate / (1.0 - errorRate)), upper = std::log((1.0 - errorRate) / errorRate);
+    double score0 = 1.0 / (1.0 + std::pow(10.0, -elo0 / 400.0)), score1 = 1.0 / (1.0 + std::pow(10.0, -elo1 / 400.0));
+    std::mt19937 rng(seed);
+    int wins = 0, draws = 0, losses = 0, verdict = 0;
+    double llr = 0.0;
+
+    for (int game = 0; game < maxGames && verdict == 0; game += 2)
+    {
+        /* More random plies than "selfPlayMatch", repeated openings add nothing to a sequential test */
+        uint8_t opening[POSITION_SIZE];
+        bool turn;
+        randomOpening(opening, turn, rng, 6);
+        if (PlayerEmpty(opening) || ComputerEmpty(opening))
+            continue;
+        for (int side = 0; side < 2; side++)
+        {
+            Environment environment(side == 0 ? agentA : agentB, side == 0 ? agentB : agentA, turn, opening);
+            environment.SetVerbose(false);
+            environment.SetClock(clock, increment);
+            int result = environment.start() * (side == 0 ? 1 : -1);
+            wins += result > 0;
+            draws += result == 0;
+            losses += result < 0;
+        }
+
+        double games = wins + draws + losses;
+        double score = (wins + 0.5 * draws) / games;
+        double variance = (wins + 0.25 * draws) / games - score * score;
+        if (variance > 0.0)
+            llr = (score1 - score0) * (2.0 * score - score0 - score1) * games / (2.0 * variance);
+        verdict = llr >= upper ? 1 : llr <= lower ? -1 : 0;
+        std::ostringstream bounds;
+        bounds << std::setprecision(3) << llr << " [" << lower << ", " << upper << "]";
+        std::cout << "\rGame " << wins + draws + losses << ": +" << wins << " =" << draws << " -" << losses << ", LLR " << bounds.str()
+            << "   " << std::flush;
+    }
+    std::cout << std::endl << agentA.Describe() << " vs " << agentB.Describe() << ": "
+        << (verdict > 0 ? "H1 accepted" : verdict < 0 ? "H0 accepted" : "undecided") << " (elo0 " << elo0 << ", elo1 " << elo1 << ")" << std::endl;
+    return verdict;
+}
+
+/*
+    Distributed solve
+    The tree is split "frontier" plies below the root into work units which are written to a shared directory:
+        <dir>/root      root position, side to move, frontier and total depth
+        <dir>/pending   units waiting for a worker
+        <dir>/claimed   units currently owned by a worker
+        <dir>/results   scores of solved units
+        <dir>/rejected  malformed units, kept for inspection instead of being searched
+    Workers claim a unit by renaming it from "pending" to "claimed". Renames are atomic within one filesystem,
+    so any amount of worker processes, on one or more hosts sharing the directory, can run at the same time.
+    The coordinator walks the frontier tree in the same order as the split and backs the unit scores up to the root.
+*/
+/* File name of unit "id", zero padded so directory listings are in split order */
+std::string unitName(uint32_t id)
+{
+    std::string name = std::to_string(id);
+    return "unit_" + std::string(name.size() < 8 ? 8 - name.size() : 0, '0') + name;
+}
+
+/*
+    Walks the tree down to "frontier" plies in a fixed order and hands every frontier node to "leaf",
+    which returns its score. Terminal nodes above the frontier are scored directly and do not become units.
+    Returns the minimax score of "position", "bestMove" receives the best move of the top call if not nullptr.
+*/
+int8_t frontierWalk(uint8_t* position, bool player, uint8_t frontier, uint32_t& unitId,
+    const std::function<int8_t(uint32_t, uint8_t*, bool)>& leaf, uint8_t* bestMove = nullptr)
+{
+    if (PlayerEmpty(position))
+    {
+        for (int i = 7; i < 13; i++)
+            position[COMPUTER_SCORE] += position[i];
+        return Evaluation(position);
+    }
+    if (ComputerEmpty(position))
+    {
+        for (int i = 0; i < 6; i++)
+            position[PLAYER_SCORE] += position[i];
+        return Evaluation(position);
+    }
+    if (frontier == 0)
+        return leaf(unitId++, position, player);
+
+    /* No alpha-beta here, every frontier node has to be visited in both the split and the backup */
+    int8_t ScoreReference = player ? 127 : -128;
+    for (int i = 0; i < 6; i++)
+    {
+        uint8_t field = player ? i : i + 7;
+        if (position[field] == 0)
+            continue;
+        uint8_t PositionCopy[POSITION_SIZE];
+        memcpy(PositionCopy, position, POSITION_LENGTH);
+        bool next = move(PositionCopy, field, player);
+        int8_t score = frontierWalk(PositionCopy, next, frontier - 1, unitId, leaf);
+        if (player ? score < ScoreReference : score > ScoreReference)
+        {
+            ScoreReference = score;
+            if (bestMove != nullptr)
+                *bestMove = field;
+        }
+    }
+    return ScoreReference;
+}
+
+/* Reads the root description of a distributed solve, returns false if "dir" does not contain one */
+bool readDistributedRoot(const fs::path& dir, uint8_t* position, bool& player, int& frontier, int& depth)
+{
+    std::ifstream file(dir / "root");
+    int value;
+    for (int i = 0; i < POSITION_LENGTH; i++)
+    {
+        if (!(file >> value))
+            return false;
+        position[i] = (uint8_t)value;
+    }
+    if (!(file >> value >> frontier >> depth))
+        return false;
+    player = value != 0;
+    return true;
+}
+
+/* Reads a unit written by "distributedSplit", returns false if the file is malformed */
+bool readDistributedUnit(const fs::path& path, uint8_t* position, bool& player, uint8_t& depth)
+{
+    std::ifstream file(path);
+    int value;
+    for (int i = 0; i < POSITION_LENGTH; i++)
+    {
+        if (!(file >> value) || value < 0 || value > 255)
+            return false;
+        position[i] = (uint8_t)value;
+    }
+    int side, plies;
+    if (!(file >> side >> plies) || (side != 0 && side != 1) || plies < 1 || plies > 255)
+        return false;
+    player = side != 0;
+    depth = (uint8_t)plies;
+    return true;
+}
+
+/* Writes "content" so that readers only ever see the complete file */
+void publishFile(const fs::path& target, const std::string& content)
+{
+    fs::path temporary = target;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << content;
+    }
+    fs::rename(temporary, target);
+}
+
+/*
+    Coordinator: split the tree of "position" into units for a search of "depth" plies in total.
+    Returns false without touching "dir" if it is not empty, units and results of an earlier solve would mix in.
+*/
+bool distributedSplit(const fs::path& dir, uint8_t* position, bool player, uint8_t frontier, uint8_t depth)
+{
+    if (fs::exists(dir) && !fs::is_empty(dir))
+    {
+        std::cout << dir << " is not empty, split into a new directory" << std::endl;
+        return false;
+    }
+    fs::create_directories(dir / "pending");
+    fs::create_directories(dir / "claimed");
+    fs::create_directories(dir / "results");
+
+    std::string root;
+    for (int i = 0; i < POSITION_LENGTH; i++)
+        root += std::to_string(position[i]) + " ";
+    root += std::to_string(player) + " " + std::to_string(frontier) + " " + std::to_string(depth) + "\n";
+    publishFile(dir / "root", root);
+
+    uint8_t PositionCopy[POSITION_SIZE];
+    memcpy(PositionCopy, position, POSITION_LENGTH);
+    uint32_t unitId = 0;
+    frontierWalk(PositionCopy, player, frontier, unitId, [&](uint32_t id, uint8_t* unit, bool unitPlayer) -> int8_t
+    {
+        std::string content;
+        for (int i = 0; i < POSITION_LENGTH; i++)
+            content += std::to_string(unit[i]) + " ";
+        content += std::to_string(unitPlayer) + " " + std::to_string(depth - frontier) + "\n";
+        publishFile(dir / "pending" / unitName(id), content);
+        return 0;
+    });
+    std::cout << "Split into " << unitId << " units at frontier " << +frontier << std::endl;
+    return true;
+}
+
+/* Worker: claim and solve pending units until none are left, returns the amount of units solved */
+uint32_t distributedWorker(const fs::path& dir)
+{
+    uint32_t solved = 0;
+    bool claimedAny = true;
+    while (claimedAny)
+    {
+        claimedAny = false;
+        std::error_code error;
+        for (const fs::directory_entry& entry : fs::directory_iterator(dir / "pending", error))
+        {
+            std::string name = entry.path().filename().string();
+            if (name.rfind("unit_", 0) != 0 || entry.path().extension() == ".tmp")
+                continue;
+            /* Only one worker can win the rename, everyone else moves on to the next unit */
+            fs::path claimed = dir / "claimed" / name;
+            fs::rename(entry.path(), claimed, error);
+            if (error)
+                continue;
+            claimedAny = true;
+
+            uint8_t position[POSITION_SIZE];
+            bool player;
+            uint8_t depth;
+            if (!readDistributedUnit(claimed, position, player, depth))
+            {
+                fs::create_directories(dir / "rejected", error);
+                fs::rename(claimed, dir / "rejected" / name, error);
+                std::cout << "[WARNING]: Rejected malformed unit " << name << std::endl;
+                continue;
+            }
+
+            SearchContext context;
+            int8_t score = minimax(position, player, depth, -128, 127, SearchSettings(), context);
+            PvLine line;
+            line.length = context.pvLength[0];
+            memcpy(line.moves, context.pv[0], line.length);
+            publishFile(dir / "results" / name, std::to_string(score) + "\n");
+            fs::remove(claimed, error);
+            solved++;
+            std::cout << "Solved " << name << ": " << +score << " (" << formatPv(line, position) << ")" << std::endl;
+        }
+    }
+    return solved;
+}
+
+/* Coordinator: back the unit results up to the root, returns false if units are still missing */
+bool distributedCollect(const fs::path& dir)
+{
+    uint8_t position[POSITION_SIZE];
+    bool player;
+    int frontier, depth;
+    if (!readDistributedRoot(dir, position, player, frontier, depth))
+    {
+        std::cout << "No distributed solve in " << dir << std::endl;
+        return false;
+    }
+
+    uint32_t unitId = 0, missing = 0;
+    uint8_t bestMove = 0;
+    int8_t score = frontierWalk(position, player, (uint8_t)frontier, unitId, [&](uint32_t id, uint8_t*, bool) -> int8_t
+    {
+        std::ifstream file(dir / "results" / unitName(id));
+        int result;
+        if (!(file >> result))
+        {
+            missing++;
+            return 0;
+        }
+        return (int8_t)result;
+    }, &bestMove);
+
+    if (missing > 0)
+    {
+        std::cout << missing << " of " << unitId << " units are not solved yet" << std::endl;
+        return false;
+    }
+    std::cout << "Evaluation: " << (player ? +(-score) : +score) << std::endl;
+    std::cout << "Calculated move: " << (player ? +bestMove : 12 - bestMove) << std::endl;
+    return true;
+}
+
+/* Coordinator: hand units of crashed workers back to "pending" */
+void distributedRequeue(const fs::path& dir)
+{
+    std::error_code error;
+    uint32_t requeued = 0;
+    for (const fs::directory_entry& entry : fs::directory_iterator(dir / "claimed", error))
+    {
+        fs::rename(entry.path(), dir / "pending" / entry.path().filename(), error);
+        if (!error)
+            requeued++;
+    }
+    std::cout << "Requeued " << requeued << " units" << std::endl;
+}
+
+/*
+Usage:
+    MancalaSolver [--hash <MB>] <mode> ...                  transposition table size of the playing and analyzing modes
+    MancalaSolver                                           play a game
+    MancalaSolver split <dir> <frontier> <depth> [stones]   split a solve of the start position into units
+    MancalaSolver worker <dir>                              solve units until none are pending
+    MancalaSolver collect <dir>                             back up the results to the root
+    MancalaSolver requeue <dir>                             return units of crashed workers
+    MancalaSolver mcts-bench <openings> <playouts> <ms> <depth> [batch]
+                                                            MCTS against minimax in self-play
+    MancalaSolver playout-bench <games>                     check and time the batched playout engine
+    MancalaSolver winrate <games> [stones]                  random playout win rates of every first move
+    MancalaSolver ntuple-match <weights> <depth> <plain depth> <openings>
+                                                            n-tuple evaluation against the store difference
+    MancalaSolver td-train <weights> <games> [rate] [lambda] [exploration]
+                                                            self-play TD(lambda) training of n-tuple weights
+    MancalaSolver datagen <dir> <records> <depth> [random %] [n-tuple weights]
+                                                            labeled record shards on all cores, depth 0 solves
+                                                            the positions that finish within a node budget
+    MancalaSolver texel-tune <records|dir> <weights> [epochs] [rate]
+                                                            fit the linear evaluation to labeled records
+    MancalaSolver linear-match <weights> <depth> <plain depth> <openings>
+                                                            linear evaluation against the store difference
+    MancalaSolver depth-calibrate <schedule> <ms> [samples] [max depth]
+                                                            depth schedule for a target time per move
+    MancalaSolver schedule-match <schedule> <fixed depth> <openings>
+                                                            scheduled depth against a fixed depth
+    MancalaSolver timed-match <seconds> <increment> <fixed depth> <openings>
+                                                            time managed search against a fixed depth
+    MancalaSolver timed <seconds> <increment>               play a game against the time managed computer
+    MancalaSolver analyze <depth> [lines] [hash MB] [stones]
+                                                            exact scores of the best root moves of the start position
+    MancalaSolver lmr-bench <ms> <positions> <openings> [moves] [reduction]
+                                                            depth at a fixed time and timed match with late move reductions
+    MancalaSolver depth-modes <nodes> <openings> [extra cost] [capture cost]
+                                                            plies, turns and fractional depth at the same node budget
+    MancalaSolver qsearch-bench <positions> <reference depth> [plies]
+                                                            accuracy and nodes with and without quiescence search
+    MancalaSolver ordering-bench <positions> <depth>        nodes with and without killer and counter moves
+    MancalaSolver etc-bench <positions> <depth>             nodes with and without enhanced transposition cutoffs
+    MancalaSolver determinism-check <positions> <depth> <runs>
+                                                            repeated searches with and without the deterministic mode
+    MancalaSolver balance-bench <positions> <depth> [threads]
+                                                            root search time with and without load balancing
+    MancalaSolver early-stop-bench <positions> <depth>      search time with and without stopping at a proven win
+    MancalaSolver pages-bench <hash MB> <positions> <depth>  search speed of the table on normal and huge pages
+    MancalaSolver replacement-bench <hash MB> <positions> <depth>
+                                                            table replacement policies under memory pressure
+    MancalaSolver probcut-calibrate <model> <positions> <depth> [reduction]
+                                                            fit the ProbCut model on searched positions
+    MancalaSolver pruning-sprt <multicut|probcut[:model]> <seconds> <increment> <max games>
+                                                            SPRT of forward pruning against the exact search
+*/
+int main(int argc, char* argv[])
+{
+    /* Table size of the searching agents, 0 = the default of each mode */
+    size_t hash = 0;
+    while (argc > 2 && std::string(argv[1]) == "--hash")
+    {
+        hash = (size_t)std::stoull(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+    std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "split" && argc > 4)
+    {
+        uint8_t stones = argc > 5 ? (uint8_t)std::stoi(argv[5]) : 4;
+        uint8_t position[POSITION_SIZE] =
+        {
+            stones,stones,stones,stones,stones,stones,
+            0,
+            stones,stones,stones,stones,stones,stones,
+            0
+        };
+        int frontier = std::stoi(argv[3]);
+        int depth = std::stoi(argv[4]);
+        if (frontier < 1 || depth <= frontier || depth > 255)
+        {
+            std::cout << "Frontier has to be at least 1 and below depth" << std::endl;
+            return 1;
+        }
+        if (!distributedSplit(argv[2], position, true, (uint8_t)frontier, (uint8_t)depth))
+            return 1;
+    }
+    else if (mode == "worker" && argc > 2)
+    {
+        std::cout << "Solved " << distributedWorker(argv[2]) << " units" << std::endl;
+    }
+    else if (mode == "collect" && argc > 2)
+    {
+        return distributedCollect(argv[2]) ? 0 : 1;
+    }
+    else if (mode == "requeue" && argc > 2)
+    {
+        distributedRequeue(argv[2]);
+    }
+    else if (mode == "mcts-bench" && argc > 5)
+    {
+        Agent mcts("mcts");
+        mcts.SetPlayouts(std::stoi(argv[3])).SetTimeLimit(std::stoi(argv[4]));
+        if (argc > 6)
+            mcts.SetPlayoutBatch(std::stoi(argv[6]));
+        selfPlayMatch(mcts, Agent("computer", (uint8_t)std::stoi(argv[5])), std::stoi(argv[2]), 1);
+    }
+    else if (mode == "playout-bench" && argc > 2)
+    {
+        playoutBench(std::stoi(argv[2]));
+    }
+    else if (mode == "ntuple-match" && argc > 5)
+    {
+        std::shared_ptr<NTupleNetwork> network = std::make_shared<NTupleNetwork>();
+        if (!network->Load(argv[2]))
+        {
+            std::cout << "Could not load n-tuple weights from " << argv[2] << std::endl;
+            return 1;
+        }
+        ntupleMatch(network, (uint8_t)std::stoi(argv[3]), (uint8_t)std::stoi(argv[4]), std::stoi(argv[5]));
+    }
+    else if (mode == "td-train" && argc > 3)
+    {
+        TdSettings settings;
+        settings.games = std::stoull(argv[3]);
+        if (argc > 4)
+            settings.learningRate = std::stof(argv[4]);
+        if (argc > 5)
+            settings.lambda = std::stof(argv[5]);
+        if (argc > 6)
+            settings.exploration = std::stod(argv[6]);
+        tdTrain(argv[2], settings);
+    }
+    else if (mode == "datagen" && argc > 4)
+    {
+        DataSettings settings;
+        settings.records = std::stoull(argv[3]);
+        settings.depth = (uint8_t)std::stoi(argv[4]);
+        if (argc > 5)
+            settings.randomShare = std::stod(argv[5]) / 100.0;
+        if (argc > 6)
+        {
+            std::shared_ptr<NTupleNetwork> network = std::make_shared<NTupleNetwork>();
+            if (!network->Load(argv[6]))
+            {
+                std::cout << "Could not load n-tuple weights from " << argv[6] << std::endl;
+                return 1;
+            }
+            settings.network = network;
+        }
+        generateData(argv[2], settings);
+    }
+    else if (mode == "texel-tune" && argc > 3)
+    {
+        texelTune(argv[2], argv[3], argc > 4 ? std::stoi(argv[4]) : 500, argc > 5 ? std::stod(argv[5]) : 0.01);
+    }
+    else if (mode == "linear-match" && argc > 5)
+    {
+        std::shared_ptr<LinearEvaluation> linear = std::make_shared<LinearEvaluation>();
+        if (!linear->Load(argv[2]))
+        {
+            std::cout << "Could not load linear weights from " << argv[2] << std::endl;
+            return 1;
+        }
+        Agent tuned("computer", (uint8_t)std::stoi(argv[3]));
+        tuned.SetLinear(linear);
+        selfPlayMatch(tuned, Agent("computer", (uint8_t)std::stoi(argv[4])), std::stoi(argv[5]), 1);
+    }
+    else if (mode == "depth-calibrate" && argc > 3)
+    {
+        calibrateDepth(argv[2], std::stod(argv[3]) / 1000.0, argc > 4 ? std::stoi(argv[4]) : 8, argc > 5 ? (uint8_t)std::stoi(argv[5]) : 40);
+    }
+    else if (mode == "schedule-match" && argc > 4)
+    {
+        std::shared_ptr<DepthSchedule> schedule = std::make_shared<DepthSchedule>();
+        if (!schedule->Load(argv[2]))
+        {
+            std::cout << "Could not load depth schedule from " << argv[2] << std::endl;
+            return 1;
+        }
+        Agent scheduled("computer", (uint8_t)std::stoi(argv[3]));
+        scheduled.SetSchedule(schedule);
+        selfPlayMatch(scheduled, Agent("computer", (uint8_t)std::stoi(argv[3])), std::stoi(argv[4]), 1);
+    }
+    else if (mode == "timed-match" && argc > 5)
+    {
+        /* Both sides run on the clock, only the timed agent looks at it */
+        selfPlayMatch(Agent("timed").SetHash(hash), Agent("computer", (uint8_t)std::stoi(argv[4])), std::stoi(argv[5]), 1,
+            std::stod(argv[2]), std::stod(argv[3]));
+    }
+    else if (mode == "timed" && argc > 3)
+    {
+        Environment game(Agent("player"), Agent("timed").SetHash(hash), true);
+        game.SetClock(std::stod(argv[2]), std::stod(argv[3]));
+        game.start();
+    }
+    else if (mode == "analyze" && argc > 2)
+    {
+        uint8_t stones = argc > 5 ? (uint8_t)std::stoi(argv[5]) : 4;
+        uint8_t position[POSITION_SIZE] =
+        {
+            stones,stones,stones,stones,stones,stones,
+            0,
+            stones,stones,stones,stones,stones,stones,
+            0
+        };
+        analyzePosition(position, true, (uint8_t)std::stoi(argv[2]), argc > 3 ? (uint8_t)std::stoi(argv[3]) : 0,
+            argc > 4 ? (size_t)std::stoul(argv[4]) : hash > 0 ? hash : 64);
+    }
+    else if (mode == "lmr-bench" && argc > 4)
+    {
+        lmrBench(std::stod(argv[2]), std::stoi(argv[3]), std::stoi(argv[4]), argc > 5 ? (uint8_t)std::stoi(argv[5]) : 2,
+            argc > 6 ? (uint8_t)std::stoi(argv[6]) : 1);
+    }
+    else if (mode == "depth-modes" && argc > 3)
+    {
+        depthModeMatch(std::stoull(argv[2]), std::stoi(argv[3]), argc > 4 ? (uint8_t)std::stoi(argv[4]) : 2,
+            argc > 5 ? (uint8_t)std::stoi(argv[5]) : 3);
+    }
+    else if (mode == "qsearch-bench" && argc > 3)
+    {
+        quiescenceBench(std::stoi(argv[2]), (uint8_t)std::stoi(argv[3]), argc > 4 ? (uint8_t)std::stoi(argv[4]) : 2);
+    }
+    else if (mode == "ordering-bench" && argc > 3)
+    {
+        orderingBench(std::stoi(argv[2]), (uint8_t)std::stoi(argv[3]));
+    }
+    else if (mode == "etc-bench" && argc > 3)
+    {
+        etcBench(std::stoi(argv[2]), (uint8_t)std::stoi(argv[3]));
+    }
+    else if (mode == "determinism-check" && argc > 4)
+    {
+        determinismCheck(std::stoi(argv[2]), (uint8_t)std::stoi(argv[3]), std::stoi(argv[4]));
+    }
+    else if (mode == "balance-bench" && argc > 3)
+    {
+        balanceBench(std::stoi(argv[2]), (uint8_t)std::stoi(argv[3]), argc > 4 ? (unsigned)std::stoi(argv[4]) : std::max(1u, std::thread::hardware_concurrency()));
+    }
+    else if (mode == "early-stop-bench" && argc > 3)
+    {
+        earlyStopBench(std::stoi(argv[2]), (uint8_t)std::stoi(argv[3]));
+    }
+    else if (mode == "pages-bench" && argc > 4)
+    {
+        pagesBench((size_t)std::stoull(argv[2]), std::stoi(argv[3]), (uint8_t)std::stoi(argv[4]));
+    }
+    else if (mode == "replacement-bench" && argc > 4)
+    {
+        replacementBench((size_t)std::stoull(argv[2]), std::stoi(argv[3]), (uint8_t)std::stoi(argv[4]));
+    }
+    else if (mode == "probcut-calibrate" && argc > 4)
+    {
+        probCutCalibrate(argv[2], std::stoi(argv[3]), (uint8_t)std::stoi(argv[4]), argc > 5 ? (uint8_t)std::stoi(argv[5]) : 4);
+    }
+    else if (mode == "pruning-sprt" && argc > 5)
+    {
+        std::string pruning = argv[2];
+        Agent pruned("timed"), exact("timed");
+        pruned.SetHash(hash > 0 ? hash : 64);
+        exact.SetHash(hash > 0 ? hash : 64);
+        if (pruning == "multicut")
+            pruned.SetMultiCut(3);
+        else if (pruning.rfind("probcut", 0) == 0)
+        {
+            std::shared_ptr<ProbCutModel> model = std::make_shared<ProbCutModel>();
+            if (pruning.size() > 8 && !model->Load(pruning.substr(8)))
+            {
+                std::cout << "[ERROR]: Could not load " << pruning.substr(8) << std::endl;
+                return 1;
+            }
+            pruned.SetProbCut(model);
+        }
+        else
+        {
+            std::cout << "Unknown pruning " << pruning << std::endl;
+            return 1;
+        }
+        sprtMatch(pruned, exact, 0.0, 20.0, std::stoi(argv[5]), 1, std::stod(argv[3]), std::stod(argv[4]));
+    }
+    else if (mode == "winrate" && argc > 2)
+    {
+        playoutWinRates(std::stoi(argv[2]), argc > 3 ? (uint8_t)std::stoi(argv[3]) : 4);
+    }
+    else if (mode.empty())
+    {
+        Environment game(Agent("player"), Agent("computer", 16).SetHash(hash), true);
+        //game.RandomizePosition();
+        game.start();
+    }
+    else
+    {
+        std::cout << "Unknown mode or missing arguments: " << mode << std::endl;
+        return 1;
+    }
+    return 0;
 }
\ No newline at end of file